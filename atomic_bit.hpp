@@ -0,0 +1,367 @@
+/**
+ * @file atomic_bit.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef ATOMIC_BIT_HPP_
+#define ATOMIC_BIT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "bit.hpp"
+
+namespace jcy {
+/**
+ * @brief Fixed size bits that threads set, clear and claim concurrently
+ * without a lock.
+ *
+ * Every element is a std::atomic and every operation is one atomic
+ * instruction on it (a compare-exchange loop for claims), with the memory
+ * order chosen by the caller. Elements are grouped in cache line aligned
+ * shards. find_and_claim_first_zero() starts its search at a shard the
+ * caller picks, so threads passing different shards (a thread index, say)
+ * claim bits on different cache lines instead of all fighting over the
+ * first free element.
+ */
+template <class BUFFER_ELEMENT_TYPE = uint64_t, bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class atomic_bit {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef size_t size_type;
+
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_t SHARD_ELEMENT_COUNT =
+      detail::CACHE_LINE_SIZE / sizeof(value_type);
+  static constexpr size_t SHARD_BIT_SIZE = SHARD_ELEMENT_COUNT * T_BIT_SIZE;
+  static constexpr size_type npos = static_cast<size_type>(-1);
+
+  static_assert(std::atomic<value_type>::is_always_lock_free,
+                "atomic_bit elements must be lock free.");
+
+ public:
+  // constructor, n bits all zero
+  explicit atomic_bit(size_type n = 0);
+  atomic_bit(const atomic_bit&) = delete;
+  atomic_bit(atomic_bit&& x) noexcept;
+
+  // assignment operator
+  atomic_bit& operator=(const atomic_bit&) = delete;
+  atomic_bit& operator=(atomic_bit&& x) noexcept;
+
+  // capacity
+  size_type size() const noexcept;
+  size_type buffer_element_count() const noexcept;
+  size_type shard_count() const noexcept;
+
+  // single bits, positions are checked. Loads take the nearest valid load
+  // order, a release order becomes relaxed and acq_rel becomes acquire.
+  bool test(size_type position,
+            std::memory_order order = std::memory_order_seq_cst) const;
+  void set(size_type position,
+           std::memory_order order = std::memory_order_seq_cst);
+  void reset(size_type position,
+             std::memory_order order = std::memory_order_seq_cst);
+  bool test_and_set(size_type position,
+                    std::memory_order order = std::memory_order_seq_cst);
+  bool test_and_reset(size_type position,
+                      std::memory_order order = std::memory_order_seq_cst);
+
+  /**
+   * @brief Whole elements, as in bit::data(). Bits past size() are kept
+   * zero, so a mask that sets them is trimmed. load() maps its order as
+   * test() does.
+   */
+  value_type load(size_type e,
+                  std::memory_order order = std::memory_order_seq_cst) const;
+  value_type fetch_or(size_type e, value_type mask,
+                      std::memory_order order = std::memory_order_seq_cst);
+  value_type fetch_and(size_type e, value_type mask,
+                       std::memory_order order = std::memory_order_seq_cst);
+
+  /**
+   * @brief Set the first zero bit at or after the start of start_shard (taken
+   * modulo shard_count()), wrapping around, and return its position, or
+   * npos when all bits are set. Only the caller that flips a bit gets it.
+   */
+  size_type find_and_claim_first_zero(
+      size_type start_shard = 0,
+      std::memory_order order = std::memory_order_seq_cst);
+
+  // snapshots, exact only when no thread writes meanwhile
+  size_type count(std::memory_order order = std::memory_order_relaxed) const
+      noexcept;
+  template <class ALLOCATOR = std::allocator<BUFFER_ELEMENT_TYPE>>
+  bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR> to_bit(
+      std::memory_order order = std::memory_order_relaxed,
+      const ALLOCATOR& allocator = ALLOCATOR()) const;
+
+ private:
+  struct alignas(detail::CACHE_LINE_SIZE) shard {
+    std::atomic<value_type> elements[SHARD_ELEMENT_COUNT];
+  };
+
+  typedef detail::bit_range<BUFFER_ELEMENT_TYPE, MSB_TO_LSB> range;
+
+  static constexpr std::memory_order load_order(
+      std::memory_order order) noexcept;
+  inline std::atomic<value_type>& element(size_type e) const noexcept;
+  inline value_type valid_mask(size_type e) const noexcept;
+  inline void check_position(size_type position) const;
+  inline void check_element(size_type e) const;
+  inline size_type claim_in_element(size_type e, std::memory_order order);
+
+ private:
+  std::unique_ptr<shard[]> shards_;
+  size_type size_ = 0;
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::atomic_bit(
+    size_type n)
+    : shards_(new shard[(n + SHARD_BIT_SIZE - 1) / SHARD_BIT_SIZE]),
+      size_(n) {
+  for (size_type e = 0; e < shard_count() * SHARD_ELEMENT_COUNT; e++) {
+    element(e).store(0, std::memory_order_relaxed);
+  }
+}
+
+// the moved from object is left empty
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::atomic_bit(
+    atomic_bit&& x) noexcept
+    : shards_(std::move(x.shards_)), size_(x.size_) {
+  x.size_ = 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator=(
+    atomic_bit&& x) noexcept {
+  if (this != &x) {
+    shards_ = std::move(x.shards_);
+    size_ = x.size_;
+    x.size_ = 0;
+  }
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() const
+    noexcept {
+  return size_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+           TYPE_CHECK>::buffer_element_count() const noexcept {
+  return (size_ + T_BIT_SIZE - 1) / T_BIT_SIZE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::shard_count() const
+    noexcept {
+  return (size_ + SHARD_BIT_SIZE - 1) / SHARD_BIT_SIZE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::test(
+    size_type position, std::memory_order order) const {
+  check_position(position);
+  return (element(position / T_BIT_SIZE).load(load_order(order)) &
+          range::mask(position % T_BIT_SIZE)) != 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::set(
+    size_type position, std::memory_order order) {
+  check_position(position);
+  element(position / T_BIT_SIZE)
+      .fetch_or(range::mask(position % T_BIT_SIZE), order);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::reset(
+    size_type position, std::memory_order order) {
+  check_position(position);
+  element(position / T_BIT_SIZE)
+      .fetch_and(static_cast<value_type>(~range::mask(position % T_BIT_SIZE)),
+                 order);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::test_and_set(
+    size_type position, std::memory_order order) {
+  check_position(position);
+  const value_type mask = range::mask(position % T_BIT_SIZE);
+  return (element(position / T_BIT_SIZE).fetch_or(mask, order) & mask) != 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::test_and_reset(
+    size_type position, std::memory_order order) {
+  check_position(position);
+  const value_type mask = range::mask(position % T_BIT_SIZE);
+  return (element(position / T_BIT_SIZE)
+              .fetch_and(static_cast<value_type>(~mask), order) &
+          mask) != 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::load(
+    size_type e, std::memory_order order) const {
+  check_element(e);
+  return element(e).load(load_order(order));
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::fetch_or(
+    size_type e, value_type mask, std::memory_order order) {
+  check_element(e);
+  return element(e).fetch_or(mask & valid_mask(e), order);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::fetch_and(
+    size_type e, value_type mask, std::memory_order order) {
+  check_element(e);
+  return element(e).fetch_and(mask, order);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+           TYPE_CHECK>::find_and_claim_first_zero(size_type start_shard,
+                                                  std::memory_order order) {
+  const size_type count = buffer_element_count();
+  if (count == 0) {
+    return npos;
+  }
+
+  const size_type first = (start_shard % shard_count()) * SHARD_ELEMENT_COUNT;
+  for (size_type k = 0; k < count; k++) {
+    const size_type e = (first + k) % count;
+    const size_type found = claim_in_element(e, order);
+    if (found != npos) {
+      return found;
+    }
+  }
+
+  return npos;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::count(
+    std::memory_order order) const noexcept {
+  size_type ones = 0;
+  for (size_type e = 0; e < buffer_element_count(); e++) {
+    ones += detail::popcount(uint64_t(element(e).load(load_order(order))));
+  }
+  return ones;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+template <class ALLOCATOR>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::to_bit(
+    std::memory_order order, const ALLOCATOR& allocator) const {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.resize(size_);
+  value_type* data = result.data();
+  for (size_type e = 0; e < buffer_element_count(); e++) {
+    data[e] = element(e).load(load_order(order));
+  }
+  return result;
+}
+
+// the order a failed compare-exchange would use, valid for a load
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+constexpr std::memory_order
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::load_order(
+    std::memory_order order) noexcept {
+  return order == std::memory_order_release
+             ? std::memory_order_relaxed
+             : (order == std::memory_order_acq_rel ? std::memory_order_acquire
+                                                   : order);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+std::atomic<typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                                TYPE_CHECK>::value_type>&
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::element(
+    size_type e) const noexcept {
+  return shards_[e / SHARD_ELEMENT_COUNT].elements[e % SHARD_ELEMENT_COUNT];
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::valid_mask(
+    size_type e) const noexcept {
+  const size_type n = std::min(T_BIT_SIZE, size_ - e * T_BIT_SIZE);
+  const uint64_t low = range::low_mask(n);
+  return static_cast<value_type>(
+      MSB_TO_LSB ? low << (T_BIT_SIZE - n) : low);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::check_position(
+    size_type position) const {
+  if (position >= size_) {
+    throw std::out_of_range("bit access is out of range.");
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::check_element(
+    size_type e) const {
+  if (e >= buffer_element_count()) {
+    throw std::out_of_range("buffer access is out of range.");
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+atomic_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::claim_in_element(
+    size_type e, std::memory_order order) {
+  std::atomic<value_type>& a = element(e);
+  const value_type valid = valid_mask(e);
+
+  // a failed exchange reloads the element, retry while it has a zero
+  value_type current = a.load(std::memory_order_relaxed);
+  value_type free = static_cast<value_type>(~current & valid);
+  while (free != 0) {
+    const size_type i = range::first_in_field(free, T_BIT_SIZE);
+    const value_type mask = range::mask(i);
+    if (a.compare_exchange_weak(current,
+                                static_cast<value_type>(current | mask),
+                                order, std::memory_order_relaxed)) {
+      return e * T_BIT_SIZE + i;
+    }
+    free = static_cast<value_type>(~current & valid);
+  }
+
+  return npos;
+}
+}  // namespace jcy
+
+#endif  // ATOMIC_BIT_HPP_
@@ -0,0 +1,641 @@
+/**
+ * @file bench.cpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bit.hpp"
+#include "bit_convert.hpp"
+#include "bit_interleave.hpp"
+#include "prefix_code.hpp"
+
+// every allocation while a benchmark body runs is counted
+namespace {
+size_t allocation_count = 0;
+}  // namespace
+
+// kept out of line, gcc warns about malloc() and free() inlined into
+// new and delete expressions otherwise
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(std::size_t n) {
+  allocation_count++;
+  if (void* p = std::malloc(n != 0 ? n : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+namespace {
+// std::bitset needs its size at compile time
+constexpr size_t BITSET_SIZE = size_t(1) << 20;
+
+// benchmark results end up here, so the bodies are not optimized away
+volatile uint64_t sink = 0;
+
+struct options {
+  size_t size = size_t(1) << 20;
+  size_t repetitions = 7;
+  std::string filter;
+  std::string json;
+  std::string baseline;
+  double threshold = 10.0;
+};
+
+struct label {
+  std::string container;
+  std::string type;
+  std::string order;
+
+  std::string name() const {
+    return type.empty() ? container
+                        : container + "<" + type +
+                              (order.empty() ? "" : "," + order) + ">";
+  }
+};
+
+struct result {
+  label where;
+  std::string operation;
+  size_t ops;
+  double bits_per_op;
+  double ns_per_op;
+  double min_ns_per_op;
+  double cv;
+  double allocations_per_op;
+
+  std::string name() const { return where.name() + "/" + operation; }
+  double bits_per_second() const {
+    return ns_per_op > 0 ? 1e9 * bits_per_op / ns_per_op : 0;
+  }
+};
+
+/**
+ * @brief Runs each body once to warm up, then repetitions times, every
+ * run on a fresh state from setup() that is not timed. The median, the
+ * minimum and the coefficient of variation of the run times are kept, and
+ * the median of the allocation counts.
+ */
+class suite {
+ public:
+  explicit suite(const options& o) : options_(o) {}
+
+  template <class SETUP, class BODY>
+  void run(const label& where, const std::string& operation, size_t ops,
+           double bits_per_op, SETUP setup, BODY body);
+
+  const std::vector<result>& results() const noexcept { return results_; }
+
+ private:
+  const options& options_;
+  std::vector<result> results_;
+};
+
+template <class SETUP, class BODY>
+void suite::run(const label& where, const std::string& operation, size_t ops,
+                double bits_per_op, SETUP setup, BODY body) {
+  result r{where, operation, ops, bits_per_op, 0, 0, 0, 0};
+  if (r.name().find(options_.filter) == std::string::npos) {
+    return;
+  }
+
+  {
+    auto state = setup();
+    sink = sink + body(state);
+  }
+
+  std::vector<double> times;
+  std::vector<size_t> allocations;
+  for (size_t k = 0; k < options_.repetitions; k++) {
+    auto state = setup();
+    const size_t before = allocation_count;
+    const auto start = std::chrono::steady_clock::now();
+    sink = sink + body(state);
+    const auto end = std::chrono::steady_clock::now();
+    allocations.push_back(allocation_count - before);
+    times.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count() / ops);
+  }
+
+  std::sort(times.begin(), times.end());
+  std::sort(allocations.begin(), allocations.end());
+  double mean = 0;
+  for (const double t : times) mean += t / times.size();
+  double variance = 0;
+  for (const double t : times) variance += (t - mean) * (t - mean);
+  variance /= times.size();
+
+  r.ns_per_op = times[times.size() / 2];
+  r.min_ns_per_op = times.front();
+  r.cv = mean > 0 ? std::sqrt(variance) / mean : 0;
+  r.allocations_per_op =
+      static_cast<double>(allocations[allocations.size() / 2]) / ops;
+  results_.push_back(r);
+
+  std::cout << std::left << std::setw(44) << r.name() << std::right
+            << std::fixed << std::setprecision(3) << std::setw(14)
+            << r.ns_per_op << std::setw(14) << r.min_ns_per_op
+            << std::setprecision(1) << std::setw(8) << 100 * r.cv
+            << std::setprecision(0) << std::setw(12)
+            << r.bits_per_second() / 1e6 << std::setprecision(3)
+            << std::setw(12) << r.allocations_per_op << std::endl;
+}
+
+struct nothing {};
+
+template <class T>
+std::string type_name() {
+  return "u" + std::to_string(8 * sizeof(T));
+}
+
+// a skewed alphabet of 256 symbols, about 4 bits a symbol
+std::vector<uint8_t> prefix_lengths() {
+  std::vector<uint8_t> lengths(256);
+  for (size_t s = 0; s < lengths.size(); s++) {
+    lengths[s] = s < 2 ? 2 : s < 6 ? 4 : s < 22 ? 7 : s < 86 ? 10 : 13;
+  }
+  return lengths;
+}
+
+std::vector<uint32_t> prefix_symbols(size_t n, std::mt19937& rng) {
+  std::vector<uint32_t> symbols(n);
+  for (uint32_t& s : symbols) {
+    const unsigned r = rng() % 100;
+    s = r < 50 ? rng() % 2
+               : r < 75 ? 2 + rng() % 4
+                        : r < 92 ? 6 + rng() % 16
+                                 : r < 98 ? 22 + rng() % 64 : 86 + rng() % 170;
+  }
+  return symbols;
+}
+
+template <class T, bool MSB_TO_LSB>
+void bench_bit(suite& s, const options& o, const std::vector<uint8_t>& bools,
+               const std::vector<unsigned char>& bytes,
+               const std::vector<uint32_t>& symbols) {
+  typedef jcy::bit<T, MSB_TO_LSB> bit_type;
+  typedef jcy::bit_reader<T, MSB_TO_LSB> reader_type;
+  const label where{"bit", type_name<T>(), MSB_TO_LSB ? "msb" : "lsb"};
+  const size_t n = o.size;
+  const size_t fields = n / 20;
+  const auto fresh = [] { return bit_type(); };
+  const auto none = [] { return nothing(); };
+
+  const bit_type x = jcy::from_bools<T, MSB_TO_LSB>(bools.data(), n);
+  const bit_type y = jcy::from_bools<T, MSB_TO_LSB>(bools.data() + n, n);
+
+  s.run(where, "push", n, 1, fresh, [&](bit_type& b) {
+    for (size_t i = 0; i < n; i++) b.push(bools[i]);
+    return b.size();
+  });
+
+  s.run(where, "push_bits", fields, 20, fresh, [&](bit_type& b) {
+    for (size_t i = 0; i < fields; i++) b.push_bits(i, 20);
+    return b.size();
+  });
+
+  s.run(where, "read", n, 1, none, [&](nothing&) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += x[i];
+    return sum;
+  });
+
+  s.run(where, "read_bits", fields, 20, [&] { return reader_type(x); },
+        [&](reader_type& r) {
+          uint64_t sum = 0;
+          for (size_t i = 0; i < fields; i++) sum += r.read_bits(20);
+          return sum;
+        });
+
+  s.run(where, "push_bytes_aligned", bytes.size(), 8, fresh,
+        [&](bit_type& b) {
+          b.push_bytes(bytes.data(), bytes.size());
+          return b.size();
+        });
+
+  s.run(where, "push_bytes_unaligned", bytes.size(), 8,
+        [] {
+          bit_type b;
+          b.push(1);
+          return b;
+        },
+        [&](bit_type& b) {
+          b.push_bytes(bytes.data(), bytes.size());
+          return b.size();
+        });
+
+  s.run(where, "operator+", 1, 2.0 * n, none, [&](nothing&) {
+    const bit_type sum = x + y;
+    return sum.size();
+  });
+
+  s.run(where, "copy", 1, n, none, [&](nothing&) {
+    const bit_type copy(x);
+    return copy.size();
+  });
+
+  constexpr size_t MOVES = 1000;
+  s.run(where, "move", MOVES, 0, [&] { return bit_type(x); },
+        [&](bit_type& b) {
+          for (size_t i = 0; i < MOVES; i++) {
+            bit_type moved(std::move(b));
+            b = std::move(moved);
+          }
+          return b.size();
+        });
+
+  s.run(where, "count", 1, n, none, [&](nothing&) { return x.count(); });
+
+  s.run(where, "and", 1, n, [&] { return bit_type(x); }, [&](bit_type& b) {
+    b &= y;
+    return b.size();
+  });
+
+  s.run(where, "or", 1, n, [&] { return bit_type(x); }, [&](bit_type& b) {
+    b |= y;
+    return b.size();
+  });
+
+  s.run(where, "xor", 1, n, [&] { return bit_type(x); }, [&](bit_type& b) {
+    b ^= y;
+    return b.size();
+  });
+
+  const jcy::bit<unsigned char, !MSB_TO_LSB> other(x);
+  s.run(where, "convert", 1, n, none, [&](nothing&) {
+    const bit_type converted(other);
+    return converted.size();
+  });
+
+  s.run(where, "from_bools", 1, n, none, [&](nothing&) {
+    return jcy::from_bools<T, MSB_TO_LSB>(bools.data(), n).size();
+  });
+
+  s.run(where, "interleave", 1, 2.0 * n, none, [&](nothing&) {
+    return jcy::interleave(x, y).size();
+  });
+
+  const bit_type z = jcy::interleave(x, y);
+  s.run(where, "deinterleave", 1, 2.0 * n, none, [&](nothing&) {
+    return jcy::deinterleave(z).first.size();
+  });
+
+  s.run(where, "transpose_planes", 1, 8.0 * bytes.size(), fresh,
+        [&](bit_type& b) {
+          jcy::transpose_planes(bytes.data(), bytes.size(), b);
+          return b.size();
+        });
+
+  const jcy::prefix_code_table<MSB_TO_LSB> table(prefix_lengths());
+  bit_type coded;
+  table.encode_n(symbols.data(), symbols.size(), coded);
+  const double code_bits = static_cast<double>(coded.size()) / symbols.size();
+
+  s.run(where, "prefix_encode", symbols.size(), code_bits, fresh,
+        [&](bit_type& b) {
+          table.encode_n(symbols.data(), symbols.size(), b);
+          return b.size();
+        });
+
+  std::vector<uint32_t> decoded(symbols.size());
+  s.run(where, "prefix_decode", symbols.size(), code_bits,
+        [&] { return reader_type(coded); },
+        [&](reader_type& r) {
+          jcy::prefix_decoder<T, MSB_TO_LSB> decoder(table, r);
+          decoder.decode_n(decoded.data(), decoded.size());
+          return uint64_t(decoded.back());
+        });
+}
+
+template <class T>
+void bench_bit(suite& s, const options& o, const std::vector<uint8_t>& bools,
+               const std::vector<unsigned char>& bytes,
+               const std::vector<uint32_t>& symbols) {
+  bench_bit<T, true>(s, o, bools, bytes, symbols);
+  bench_bit<T, false>(s, o, bools, bytes, symbols);
+}
+
+void bench_vector_bool(suite& s, const options& o,
+                       const std::vector<uint8_t>& bools) {
+  typedef std::vector<bool> vector_type;
+  const label where{"vector<bool>", "", ""};
+  const size_t n = o.size;
+  const auto none = [] { return nothing(); };
+
+  const vector_type x(bools.begin(), bools.begin() + n);
+  const vector_type y(bools.begin() + n, bools.begin() + 2 * n);
+
+  s.run(where, "push", n, 1, [] { return vector_type(); },
+        [&](vector_type& v) {
+          for (size_t i = 0; i < n; i++) v.push_back(bools[i] != 0);
+          return v.size();
+        });
+
+  s.run(where, "read", n, 1, none, [&](nothing&) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += x[i];
+    return sum;
+  });
+
+  s.run(where, "operator+", 1, 2.0 * n, none, [&](nothing&) {
+    vector_type sum(x);
+    sum.insert(sum.end(), y.begin(), y.end());
+    return sum.size();
+  });
+
+  s.run(where, "copy", 1, n, none, [&](nothing&) {
+    const vector_type copy(x);
+    return copy.size();
+  });
+
+  constexpr size_t MOVES = 1000;
+  s.run(where, "move", MOVES, 0, [&] { return vector_type(x); },
+        [&](vector_type& v) {
+          for (size_t i = 0; i < MOVES; i++) {
+            vector_type moved(std::move(v));
+            v = std::move(moved);
+          }
+          return v.size();
+        });
+
+  s.run(where, "count", 1, n, none, [&](nothing&) {
+    return static_cast<uint64_t>(std::count(x.begin(), x.end(), true));
+  });
+
+  // no bulk operations, a bit at a time
+  s.run(where, "and", 1, n, [&] { return vector_type(x); },
+        [&](vector_type& v) {
+          for (size_t i = 0; i < n; i++) v[i] = v[i] && y[i];
+          return v.size();
+        });
+
+  s.run(where, "or", 1, n, [&] { return vector_type(x); },
+        [&](vector_type& v) {
+          for (size_t i = 0; i < n; i++) v[i] = v[i] || y[i];
+          return v.size();
+        });
+
+  s.run(where, "xor", 1, n, [&] { return vector_type(x); },
+        [&](vector_type& v) {
+          for (size_t i = 0; i < n; i++) v[i] = v[i] != y[i];
+          return v.size();
+        });
+}
+
+void bench_bitset(suite& s, const std::vector<uint8_t>& bools) {
+  typedef std::bitset<BITSET_SIZE> bitset_type;
+  typedef std::unique_ptr<bitset_type> pointer;
+  const label where{"bitset", std::to_string(BITSET_SIZE), ""};
+  const size_t n = BITSET_SIZE;
+  const auto none = [] { return nothing(); };
+
+  // too large for the stack
+  pointer x(new bitset_type());
+  pointer y(new bitset_type());
+  for (size_t i = 0; i < n; i++) {
+    (*x)[i] = bools[i % bools.size()] != 0;
+    (*y)[i] = bools[(i + n) % bools.size()] != 0;
+  }
+
+  s.run(where, "set", n, 1, [] { return pointer(new bitset_type()); },
+        [&](pointer& b) {
+          for (size_t i = 0; i < n; i++) (*b)[i] = bools[i % bools.size()];
+          return uint64_t((*b)[n - 1]);
+        });
+
+  s.run(where, "read", n, 1, none, [&](nothing&) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += (*x)[i];
+    return sum;
+  });
+
+  s.run(where, "copy", 1, n, none, [&](nothing&) {
+    const pointer copy(new bitset_type(*x));
+    return uint64_t((*copy)[0]);
+  });
+
+  s.run(where, "count", 1, n, none, [&](nothing&) {
+    return static_cast<uint64_t>(x->count());
+  });
+
+  s.run(where, "and", 1, n, [&] { return pointer(new bitset_type(*x)); },
+        [&](pointer& b) {
+          *b &= *y;
+          return uint64_t((*b)[0]);
+        });
+
+  s.run(where, "or", 1, n, [&] { return pointer(new bitset_type(*x)); },
+        [&](pointer& b) {
+          *b |= *y;
+          return uint64_t((*b)[0]);
+        });
+
+  s.run(where, "xor", 1, n, [&] { return pointer(new bitset_type(*x)); },
+        [&](pointer& b) {
+          *b ^= *y;
+          return uint64_t((*b)[0]);
+        });
+}
+
+void write_json(std::ostream& out, const options& o,
+                const std::vector<result>& results) {
+  out << "{\n  \"context\": {\"size_bits\": " << o.size
+      << ", \"repetitions\": " << o.repetitions << ", \"compiler\": \""
+#if defined(__VERSION__)
+      << __VERSION__
+#endif
+      << "\", \"avx2\": "
+      << (jcy::detail::cpu_has_avx2() ? "true" : "false") << "},\n";
+
+  // one benchmark a line, read back by --baseline
+  out << "  \"benchmarks\": [\n" << std::setprecision(6);
+  for (size_t i = 0; i < results.size(); i++) {
+    const result& r = results[i];
+    out << "    {\"name\": \"" << r.name() << "\", \"container\": \""
+        << r.where.container << "\", \"type\": \"" << r.where.type
+        << "\", \"order\": \"" << r.where.order << "\", \"operation\": \""
+        << r.operation << "\", \"ops\": " << r.ops
+        << ", \"bits_per_op\": " << r.bits_per_op
+        << ", \"ns_per_op\": " << r.ns_per_op
+        << ", \"ns_per_op_min\": " << r.min_ns_per_op << ", \"cv\": " << r.cv
+        << ", \"bits_per_second\": " << r.bits_per_second()
+        << ", \"allocations_per_op\": " << r.allocations_per_op << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+// ns_per_op of each name in a file from write_json()
+std::vector<std::pair<std::string, double>> read_baseline(
+    const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("baseline file can not be opened.");
+  }
+
+  const std::string name_key = "\"name\": \"";
+  const std::string time_key = "\"ns_per_op\": ";
+  std::vector<std::pair<std::string, double>> baseline;
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t name = line.find(name_key);
+    const size_t time = line.find(time_key);
+    if ((name == std::string::npos) || (time == std::string::npos)) {
+      continue;
+    }
+
+    const size_t begin = name + name_key.size();
+    baseline.emplace_back(
+        line.substr(begin, line.find('"', begin) - begin),
+        std::strtod(line.c_str() + time + time_key.size(), nullptr));
+  }
+  return baseline;
+}
+
+// prints the benchmarks slower than the baseline, true if there are any
+bool compare(const options& o,
+             const std::vector<std::pair<std::string, double>>& baseline,
+             const std::vector<result>& results) {
+  bool regressed = false;
+  for (const result& r : results) {
+    for (const auto& old : baseline) {
+      if ((old.first != r.name()) || (old.second <= 0)) {
+        continue;
+      }
+
+      const double change = 100 * (r.ns_per_op / old.second - 1);
+      if (change > o.threshold) {
+        std::cout << "regression " << r.name() << " " << old.second << " -> "
+                  << r.ns_per_op << " ns/op (+" << std::setprecision(1)
+                  << change << "%)" << std::setprecision(3) << std::endl;
+        regressed = true;
+      }
+    }
+  }
+  return regressed;
+}
+
+void usage() {
+  std::cerr << "usage: bench [--size bits] [--repetitions n] [--filter text]"
+               " [--json file] [--baseline file] [--threshold percent]\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  options o;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (i + 1 == argc) {
+      usage();
+      return 2;
+    }
+
+    const std::string value = argv[++i];
+    if (arg == "--size") {
+      o.size = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--repetitions") {
+      o.repetitions = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--filter") {
+      o.filter = value;
+    } else if (arg == "--json") {
+      o.json = value;
+    } else if (arg == "--baseline") {
+      o.baseline = value;
+    } else if (arg == "--threshold") {
+      o.threshold = std::strtod(value.c_str(), nullptr);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  // fields of 20 bits and whole bytes need some room
+  if ((o.size < 64) || (o.repetitions == 0)) {
+    usage();
+    return 2;
+  }
+
+  // a bad baseline is reported before the sweep, not after it
+  std::vector<std::pair<std::string, double>> baseline;
+  if (!o.baseline.empty()) {
+    try {
+      baseline = read_baseline(o.baseline);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(2019);
+  std::vector<uint8_t> bools(2 * o.size);
+  for (uint8_t& b : bools) b = rng() & 1;
+  std::vector<unsigned char> bytes(o.size / 8);
+  for (unsigned char& b : bytes) b = static_cast<unsigned char>(rng());
+  const std::vector<uint32_t> symbols = prefix_symbols(o.size / 4, rng);
+
+  std::cout << std::left << std::setw(44) << "benchmark" << std::right
+            << std::setw(14) << "ns/op" << std::setw(14) << "min ns/op"
+            << std::setw(8) << "cv %" << std::setw(12) << "Mbit/s"
+            << std::setw(12) << "allocs/op" << std::endl;
+
+  suite s(o);
+  bench_bit<uint8_t>(s, o, bools, bytes, symbols);
+  bench_bit<uint16_t>(s, o, bools, bytes, symbols);
+  bench_bit<uint32_t>(s, o, bools, bytes, symbols);
+  bench_bit<uint64_t>(s, o, bools, bytes, symbols);
+  bench_vector_bool(s, o, bools);
+  bench_bitset(s, bools);
+
+  if (!o.json.empty()) {
+    std::ofstream out(o.json);
+    write_json(out, o, s.results());
+    if (!out) {
+      std::cerr << "json file can not be written.\n";
+      return 2;
+    }
+  }
+
+  if (!o.baseline.empty()) {
+    return compare(o, baseline, s.results()) ? 1 : 0;
+  }
+
+  return 0;
+}
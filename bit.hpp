@@ -12,538 +12,4157 @@
 #ifndef BIT_HPP_
 #define BIT_HPP_
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <iterator>
 #include <limits>
+#include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIT_HPP_X86_DISPATCH_
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace jcy {
-template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
-          class = typename std::enable_if<
-              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
-class bit {
+namespace detail {
+// bytes in a cache line, the unit of false sharing
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// x must not be zero
+inline unsigned countl_zero(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_clzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, x);
+  return 63u - static_cast<unsigned>(index);
+#else
+  unsigned n = 0;
+  while ((x & (uint64_t(1) << 63)) == 0) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// x must not be zero
+inline unsigned countr_zero(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<unsigned>(index);
+#else
+  unsigned n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+inline unsigned popcount(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return static_cast<unsigned>(__popcnt64(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ull);
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return static_cast<unsigned>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Kernels dispatch on AVX2 and SSE2 only. BMI2 pdep/pext would shorten the
+// bit spreads and gathers, but they are microcoded on AMD before Zen 3.
+inline bool cpu_has_avx2() noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  static const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+inline bool cpu_has_popcnt() noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  static const bool popcnt = __builtin_cpu_supports("popcnt") != 0;
+  return popcnt;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Byte kernels behind the bulk operations.
+ *
+ * They see the buffer as plain bytes, which is valid for every element type
+ * and bit order since each output bit only depends on the input bits at the
+ * same place. AVX2 is picked at run time, SSE2 and NEON at compile time.
+ */
+enum class bitwise_op { bit_and, bit_or, bit_xor, bit_andnot, bit_not };
+
+template <bitwise_op OP>
+inline uint64_t bitwise_word(uint64_t a, uint64_t b) noexcept {
+  switch (OP) {
+    case bitwise_op::bit_and:
+      return a & b;
+    case bitwise_op::bit_or:
+      return a | b;
+    case bitwise_op::bit_xor:
+      return a ^ b;
+    case bitwise_op::bit_andnot:
+      return a & ~b;
+    default:
+      return ~a;
+  }
+}
+
+template <bitwise_op OP>
+inline void bitwise_scalar(unsigned char* dst, const unsigned char* src,
+                           size_t n) noexcept {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t a;
+    uint64_t b = 0;
+    std::memcpy(&a, dst + i, 8);
+    if (OP != bitwise_op::bit_not) {
+      std::memcpy(&b, src + i, 8);
+    }
+    a = bitwise_word<OP>(a, b);
+    std::memcpy(dst + i, &a, 8);
+  }
+
+  for (; i < n; i++) {
+    const uint64_t b = OP != bitwise_op::bit_not ? src[i] : 0;
+    dst[i] = static_cast<unsigned char>(bitwise_word<OP>(dst[i], b));
+  }
+}
+
+#if defined(BIT_HPP_X86_DISPATCH_)
+template <bitwise_op OP>
+__attribute__((target("avx2"))) inline void bitwise_avx2(
+    unsigned char* dst, const unsigned char* src, size_t n) noexcept {
+  const __m256i ones = _mm256_set1_epi8(-1);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    __m256i b = ones;
+    if (OP != bitwise_op::bit_not) {
+      b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    }
+
+    switch (OP) {
+      case bitwise_op::bit_and:
+        a = _mm256_and_si256(a, b);
+        break;
+      case bitwise_op::bit_or:
+        a = _mm256_or_si256(a, b);
+        break;
+      case bitwise_op::bit_xor:
+      case bitwise_op::bit_not:
+        a = _mm256_xor_si256(a, b);
+        break;
+      case bitwise_op::bit_andnot:
+        a = _mm256_andnot_si256(b, a);
+        break;
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), a);
+  }
+
+  bitwise_scalar<OP>(dst + i, src == nullptr ? src : src + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline size_t popcount_avx2(
+    const unsigned char* data, size_t n) noexcept {
+  // nibble lookup with vpshufb, summed with vpsadbw
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i total = zero;
+
+  size_t i = 0;
+  while (i + 32 <= n) {
+    // byte counters take at most 31 rounds of 8 before they overflow
+    __m256i local = zero;
+    for (int round = 0; (round < 31) && (i + 32 <= n); round++, i += 32) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      const __m256i low = _mm256_and_si256(v, low_mask);
+      const __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+      local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, low));
+      local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, high));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(local, zero));
+  }
+
+  size_t count = static_cast<size_t>(_mm256_extract_epi64(total, 0)) +
+                 static_cast<size_t>(_mm256_extract_epi64(total, 1)) +
+                 static_cast<size_t>(_mm256_extract_epi64(total, 2)) +
+                 static_cast<size_t>(_mm256_extract_epi64(total, 3));
+  for (; i < n; i++) {
+    count += popcount(uint64_t(data[i]));
+  }
+
+  return count;
+}
+
+__attribute__((target("popcnt"))) inline size_t popcount_popcnt(
+    const unsigned char* data, size_t n) noexcept {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    count += static_cast<size_t>(__builtin_popcountll(word));
+  }
+
+  for (; i < n; i++) {
+    count += static_cast<size_t>(__builtin_popcountll(data[i]));
+  }
+
+  return count;
+}
+#endif
+
+#if defined(__SSE2__)
+template <bitwise_op OP>
+inline void bitwise_sse2(unsigned char* dst, const unsigned char* src,
+                         size_t n) noexcept {
+  const __m128i ones = _mm_set1_epi8(-1);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i b = ones;
+    if (OP != bitwise_op::bit_not) {
+      b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    }
+
+    switch (OP) {
+      case bitwise_op::bit_and:
+        a = _mm_and_si128(a, b);
+        break;
+      case bitwise_op::bit_or:
+        a = _mm_or_si128(a, b);
+        break;
+      case bitwise_op::bit_xor:
+      case bitwise_op::bit_not:
+        a = _mm_xor_si128(a, b);
+        break;
+      case bitwise_op::bit_andnot:
+        a = _mm_andnot_si128(b, a);
+        break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), a);
+  }
+
+  bitwise_scalar<OP>(dst + i, src == nullptr ? src : src + i, n - i);
+}
+#elif defined(__ARM_NEON)
+template <bitwise_op OP>
+inline void bitwise_neon(unsigned char* dst, const unsigned char* src,
+                         size_t n) noexcept {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t a = vld1q_u8(dst + i);
+    uint8x16_t b = vdupq_n_u8(0xFF);
+    if (OP != bitwise_op::bit_not) {
+      b = vld1q_u8(src + i);
+    }
+
+    switch (OP) {
+      case bitwise_op::bit_and:
+        a = vandq_u8(a, b);
+        break;
+      case bitwise_op::bit_or:
+        a = vorrq_u8(a, b);
+        break;
+      case bitwise_op::bit_xor:
+      case bitwise_op::bit_not:
+        a = veorq_u8(a, b);
+        break;
+      case bitwise_op::bit_andnot:
+        a = vbicq_u8(a, b);
+        break;
+    }
+    vst1q_u8(dst + i, a);
+  }
+
+  bitwise_scalar<OP>(dst + i, src == nullptr ? src : src + i, n - i);
+}
+
+inline size_t popcount_neon(const unsigned char* data, size_t n) noexcept {
+  size_t count = 0;
+  size_t i = 0;
+  while (i + 16 <= n) {
+    // 8-bit lanes take at most 31 rounds of 8 before they overflow
+    uint8x16_t local = vdupq_n_u8(0);
+    for (int round = 0; (round < 31) && (i + 16 <= n); round++, i += 16) {
+      local = vaddq_u8(local, vcntq_u8(vld1q_u8(data + i)));
+    }
+    count += vaddlvq_u8(local);
+  }
+
+  for (; i < n; i++) {
+    count += popcount(uint64_t(data[i]));
+  }
+
+  return count;
+}
+#endif
+
+template <bitwise_op OP>
+inline void bitwise(unsigned char* dst, const unsigned char* src,
+                    size_t n) noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  if (cpu_has_avx2()) {
+    bitwise_avx2<OP>(dst, src, n);
+    return;
+  }
+#endif
+
+#if defined(__SSE2__)
+  bitwise_sse2<OP>(dst, src, n);
+#elif defined(__ARM_NEON)
+  bitwise_neon<OP>(dst, src, n);
+#else
+  bitwise_scalar<OP>(dst, src, n);
+#endif
+}
+
+inline size_t popcount_scalar(const unsigned char* data, size_t n) noexcept {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    count += popcount(word);
+  }
+
+  for (; i < n; i++) {
+    count += popcount(uint64_t(data[i]));
+  }
+
+  return count;
+}
+
+// set bits in n bytes, independent of how the bytes group into elements
+inline size_t popcount(const unsigned char* data, size_t n) noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  if ((n >= 256) && cpu_has_avx2()) {
+    return popcount_avx2(data, n);
+  }
+
+  if (cpu_has_popcnt()) {
+    return popcount_popcnt(data, n);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  return popcount_neon(data, n);
+#endif
+
+  return popcount_scalar(data, n);
+}
+
+// true if any of n bytes is not zero
+inline bool any(const unsigned char* data, size_t n) noexcept {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    uint64_t word[4];
+    std::memcpy(word, data + i, 32);
+    if ((word[0] | word[1] | word[2] | word[3]) != 0) {
+      return true;
+    }
+  }
+
+  for (; i < n; i++) {
+    if (data[i] != 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// true if all of n bytes are 0xFF
+inline bool all(const unsigned char* data, size_t n) noexcept {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    uint64_t word[4];
+    std::memcpy(word, data + i, 32);
+    if ((word[0] & word[1] & word[2] & word[3]) != ~uint64_t(0)) {
+      return false;
+    }
+  }
+
+  for (; i < n; i++) {
+    if (data[i] != 0xFF) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+inline uint8_t byteswap(uint8_t x) noexcept { return x; }
+
+inline uint16_t byteswap(uint16_t x) noexcept {
+  return static_cast<uint16_t>((x >> 8) | (x << 8));
+}
+
+inline uint32_t byteswap(uint32_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap32(x);
+#elif defined(_MSC_VER)
+  return _byteswap_ulong(x);
+#else
+  return (x >> 24) | ((x >> 8) & 0xFF00u) | ((x << 8) & 0xFF0000u) | (x << 24);
+#endif
+}
+
+inline uint64_t byteswap(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap64(x);
+#elif defined(_MSC_VER)
+  return _byteswap_uint64(x);
+#else
+  return (uint64_t(byteswap(static_cast<uint32_t>(x))) << 32) |
+         byteswap(static_cast<uint32_t>(x >> 32));
+#endif
+}
+
+// element from sizeof(T) bytes, the first byte most (or least) significant
+template <class T, bool MOST_SIGNIFICANT_FIRST>
+inline T load_element(const unsigned char* bytes) noexcept {
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && \
+                          __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  typedef typename std::conditional<
+      sizeof(T) == 1, uint8_t,
+      typename std::conditional<
+          sizeof(T) == 2, uint16_t,
+          typename std::conditional<sizeof(T) == 4, uint32_t,
+                                    uint64_t>::type>::type>::type word_type;
+  if (sizeof(T) == sizeof(word_type)) {
+    word_type word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return static_cast<T>(MOST_SIGNIFICANT_FIRST ? byteswap(word) : word);
+  }
+#endif
+
+  T element = 0;
+  for (size_t k = 0; k < sizeof(T); k++) {
+    const size_t shift =
+        MOST_SIGNIFICANT_FIRST ? 8 * (sizeof(T) - 1 - k) : 8 * k;
+    element |= static_cast<T>(T(bytes[k]) << shift);
+  }
+  return element;
+}
+
+inline uint64_t reverse_bits_in_bytes(uint64_t x) noexcept {
+  x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+  x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+  return ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) |
+         ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+}
+
+inline uint64_t reverse_bits(uint64_t x) noexcept {
+  return byteswap(reverse_bits_in_bytes(x));
+}
+
+/**
+ * @brief Copy of n bits from elements of type S in order SRC_MSB_TO_LSB to
+ * elements of type T in order MSB_TO_LSB, sizes and orders may differ.
+ *
+ * On a little endian host bit i of either side is in byte i / 8 up to the
+ * order of the bytes in an element and of the bits in a byte, so the copy
+ * is a fixed byte shuffle within 16 bytes, plus a bit reversal of every
+ * byte when the orders differ. That is done with vpshufb and a nibble
+ * table (tbl and rbit on NEON), and the rest a 64-bit field at a time.
+ */
+template <class S, bool SRC_MSB_TO_LSB, class T, bool MSB_TO_LSB>
+struct bit_transcode {
+  static constexpr size_t S_BIT_SIZE = 8 * sizeof(S);
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(T);
+
+  // the same bytes in memory whatever the host
+  static constexpr bool SAME_LAYOUT =
+      (SRC_MSB_TO_LSB == MSB_TO_LSB) && (sizeof(S) == sizeof(T));
+
+  // memory byte of sequence byte j, the mapping is its own inverse
+  static constexpr size_t byte_of(size_t j, size_t size, bool msb) noexcept {
+    return msb ? j / size * size + (size - 1 - j % size) : j;
+  }
+
+  // byte m of a 16-byte block of dst comes from byte shuffle(m) of src
+  static constexpr size_t shuffle(size_t m) noexcept {
+    return byte_of(byte_of(m, sizeof(T), MSB_TO_LSB), sizeof(S),
+                   SRC_MSB_TO_LSB);
+  }
+
+  // bits [64 * chunk, 64 * chunk + 64) of count elements, the first bit
+  // most (or least) significant as for MSB_TO_LSB
+  template <class E, bool M>
+  static uint64_t load_chunk(const E* data, size_t count,
+                             size_t chunk) noexcept {
+    constexpr size_t W = 8 * sizeof(E);
+    const size_t first = chunk * (64 / W);
+    const size_t last = std::min(count, first + 64 / W);
+
+    uint64_t field = 0;
+    for (size_t k = first; k < last; k++) {
+      const size_t j = k - first;
+      field |= uint64_t(data[k]) << (M ? 64 - W * (j + 1) : W * j);
+    }
+    return field;
+  }
+
+  template <class E, bool M>
+  static void store_chunk(E* data, size_t count, size_t chunk,
+                          uint64_t field) noexcept {
+    constexpr size_t W = 8 * sizeof(E);
+    const size_t first = chunk * (64 / W);
+    const size_t last = std::min(count, first + 64 / W);
+
+    for (size_t k = first; k < last; k++) {
+      const size_t j = k - first;
+      data[k] = static_cast<E>(field >> (M ? 64 - W * (j + 1) : W * j));
+    }
+  }
+
+  // from the 64-bit chunk first on, the padding of src must be zero
+  static void copy_scalar(T* dst, const S* src, size_t n,
+                          size_t first) noexcept {
+    const size_t src_count = (n + S_BIT_SIZE - 1) / S_BIT_SIZE;
+    const size_t dst_count = (n + T_BIT_SIZE - 1) / T_BIT_SIZE;
+    for (size_t chunk = first; 64 * chunk < n; chunk++) {
+      uint64_t field = load_chunk<S, SRC_MSB_TO_LSB>(src, src_count, chunk);
+      if (SRC_MSB_TO_LSB != MSB_TO_LSB) {
+        field = reverse_bits(field);
+      }
+      store_chunk<T, MSB_TO_LSB>(dst, dst_count, chunk, field);
+    }
+  }
+
+#if defined(BIT_HPP_X86_DISPATCH_)
+  // whole 32-byte blocks of n bytes, returns the bytes copied
+  __attribute__((target("avx2"))) static size_t copy_avx2(
+      unsigned char* dst, const unsigned char* src, size_t n) noexcept {
+    alignas(32) unsigned char order[32];
+    for (size_t m = 0; m < 32; m++) {
+      order[m] = static_cast<unsigned char>(shuffle(m % 16));
+    }
+    const __m256i bytes =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(order));
+    const __m256i reversed =
+        _mm256_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9,
+                         0x5, 0xD, 0x3, 0xB, 0x7, 0xF, 0x0, 0x8, 0x4, 0xC,
+                         0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB,
+                         0x7, 0xF);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      __m256i v = _mm256_shuffle_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)),
+          bytes);
+      if (SRC_MSB_TO_LSB != MSB_TO_LSB) {
+        // the reversed low nibble is the high one and the other way round
+        const __m256i high = _mm256_shuffle_epi8(
+            reversed, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        v = _mm256_or_si256(
+            _mm256_slli_epi16(
+                _mm256_shuffle_epi8(reversed, _mm256_and_si256(v, low)), 4),
+            high);
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    return i;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  static size_t copy_neon(unsigned char* dst, const unsigned char* src,
+                          size_t n) noexcept {
+    unsigned char order[16];
+    for (size_t m = 0; m < 16; m++) {
+      order[m] = static_cast<unsigned char>(shuffle(m));
+    }
+    const uint8x16_t bytes = vld1q_u8(order);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      uint8x16_t v = vqtbl1q_u8(vld1q_u8(src + i), bytes);
+      if (SRC_MSB_TO_LSB != MSB_TO_LSB) {
+        v = vrbitq_u8(v);
+      }
+      vst1q_u8(dst + i, v);
+    }
+    return i;
+  }
+#endif
+
+  // n bits, the padding of src must be zero and is zero in dst
+  static void copy(T* dst, const S* src, size_t n) noexcept {
+    const size_t src_bytes = (n + S_BIT_SIZE - 1) / S_BIT_SIZE * sizeof(S);
+    const size_t dst_bytes = (n + T_BIT_SIZE - 1) / T_BIT_SIZE * sizeof(T);
+    if (SAME_LAYOUT) {
+      std::memcpy(dst, src, dst_bytes);
+      return;
+    }
+
+    size_t done = 0;
+#if defined(BIT_HPP_X86_DISPATCH_)
+    if (cpu_has_avx2()) {
+      done = copy_avx2(reinterpret_cast<unsigned char*>(dst),
+                       reinterpret_cast<const unsigned char*>(src),
+                       std::min(src_bytes, dst_bytes));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    done = copy_neon(reinterpret_cast<unsigned char*>(dst),
+                     reinterpret_cast<const unsigned char*>(src),
+                     std::min(src_bytes, dst_bytes));
+#endif
+
+    // done is a multiple of 16 bytes, so of a chunk on both sides
+    copy_scalar(dst, src, n, done / 8);
+  }
+};
+
+/**
+ * @brief Bit range kernels over raw elements.
+ *
+ * A field of n bits is returned (and taken) in the push_bits() layout, so a
+ * field of T_BIT_SIZE bits at an element boundary is the element itself.
+ * Ranges are processed a whole destination element at a time.
+ */
+template <class T, bool MSB_TO_LSB>
+struct bit_range {
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(T);
+
+  static constexpr uint64_t low_mask(size_t n) noexcept {
+    return n >= 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+  }
+
+  static constexpr T mask(size_t i) noexcept {
+    return static_cast<T>(T(1) << (MSB_TO_LSB ? (T_BIT_SIZE - 1) - i : i));
+  }
+
+  // n is 1 to T_BIT_SIZE
+  static constexpr T extract(const T* data, size_t pos, size_t n) noexcept {
+    const size_t e = pos / T_BIT_SIZE;
+    const size_t o = pos % T_BIT_SIZE;
+    const uint64_t first = data[e];
+
+    if (o + n <= T_BIT_SIZE) {
+      return static_cast<T>(
+          (MSB_TO_LSB ? first >> (T_BIT_SIZE - o - n) : first >> o) &
+          low_mask(n));
+    }
+
+    const size_t head = T_BIT_SIZE - o;
+    const size_t tail = n - head;
+    const uint64_t second = data[e + 1];
+    if (MSB_TO_LSB) {
+      return static_cast<T>(((first & low_mask(head)) << tail) |
+                            (second >> (T_BIT_SIZE - tail)));
+    }
+    return static_cast<T>((first >> o) | ((second & low_mask(tail)) << head));
+  }
+
+  // n is 1 to T_BIT_SIZE, value holds no more than n bits
+  static constexpr void deposit(T* data, size_t pos, size_t n,
+                                T value) noexcept {
+    const size_t e = pos / T_BIT_SIZE;
+    const size_t o = pos % T_BIT_SIZE;
+    const uint64_t v = value;
+
+    if (o + n <= T_BIT_SIZE) {
+      const size_t shift = MSB_TO_LSB ? T_BIT_SIZE - o - n : o;
+      const uint64_t m = low_mask(n) << shift;
+      data[e] = static_cast<T>((data[e] & ~m) | (v << shift));
+      return;
+    }
+
+    const size_t head = T_BIT_SIZE - o;
+    const size_t tail = n - head;
+    if (MSB_TO_LSB) {
+      data[e] = static_cast<T>((data[e] & ~low_mask(head)) | (v >> tail));
+      const uint64_t m = low_mask(tail) << (T_BIT_SIZE - tail);
+      const uint64_t low = (v & low_mask(tail)) << (T_BIT_SIZE - tail);
+      data[e + 1] = static_cast<T>((data[e + 1] & ~m) | low);
+    } else {
+      data[e] = static_cast<T>((data[e] & low_mask(o)) | (v << o));
+      data[e + 1] =
+          static_cast<T>((data[e + 1] & ~low_mask(tail)) | (v >> head));
+    }
+  }
+
+  // first set bit of an n-bit field, field must not be zero
+  static size_t first_in_field(uint64_t field, size_t n) noexcept {
+    return MSB_TO_LSB ? countl_zero(field) - (64 - n) : countr_zero(field);
+  }
+
+  // copy front to back, dst may overlap src only below it
+  static void copy(T* dst, size_t dpos, const T* src, size_t spos,
+                   size_t n) noexcept {
+    if ((n != 0) && (dpos % T_BIT_SIZE != 0)) {
+      const size_t k = std::min(n, T_BIT_SIZE - dpos % T_BIT_SIZE);
+      deposit(dst, dpos, k, extract(src, spos, k));
+      dpos += k;
+      spos += k;
+      n -= k;
+    }
+
+    T* out = dst + dpos / T_BIT_SIZE;
+    const T* in = src + spos / T_BIT_SIZE;
+    const size_t o = spos % T_BIT_SIZE;
+    const size_t count = n / T_BIT_SIZE;
+    if (o == 0) {
+      if (count != 0) {
+        std::memmove(out, in, count * sizeof(T));
+      }
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        const uint64_t first = in[i];
+        const uint64_t second = in[i + 1];
+        out[i] = static_cast<T>(
+            MSB_TO_LSB ? (first << o) | (second >> (T_BIT_SIZE - o))
+                       : (first >> o) | (second << (T_BIT_SIZE - o)));
+      }
+    }
+
+    const size_t rest = n % T_BIT_SIZE;
+    if (rest != 0) {
+      const size_t done = count * T_BIT_SIZE;
+      deposit(dst, dpos + done, rest, extract(src, spos + done, rest));
+    }
+  }
+
+  // copy back to front, dst may overlap src only above it
+  static void copy_backward(T* dst, size_t dpos, const T* src, size_t spos,
+                            size_t n) noexcept {
+    const size_t dend = dpos + n;
+    if ((n != 0) && (dend % T_BIT_SIZE != 0)) {
+      const size_t k = std::min(n, dend % T_BIT_SIZE);
+      n -= k;
+      deposit(dst, dpos + n, k, extract(src, spos + n, k));
+    }
+
+    // whole elements end at dend, a head of rest bits is left before them
+    const size_t rest = n % T_BIT_SIZE;
+    const size_t count = n / T_BIT_SIZE;
+    T* out = dst + (dpos + rest) / T_BIT_SIZE;
+    const T* in = src + (spos + rest) / T_BIT_SIZE;
+    const size_t o = (spos + rest) % T_BIT_SIZE;
+    if (o == 0) {
+      if (count != 0) {
+        std::memmove(out, in, count * sizeof(T));
+      }
+    } else {
+      for (size_t i = count; i-- > 0;) {
+        const uint64_t first = in[i];
+        const uint64_t second = in[i + 1];
+        out[i] = static_cast<T>(
+            MSB_TO_LSB ? (first << o) | (second >> (T_BIT_SIZE - o))
+                       : (first >> o) | (second << (T_BIT_SIZE - o)));
+      }
+    }
+
+    if (rest != 0) {
+      deposit(dst, dpos, rest, extract(src, spos, rest));
+    }
+  }
+
+  static void fill(T* data, size_t pos, size_t n, bool value) noexcept {
+    const T ones = static_cast<T>(~T(0));
+    if ((n != 0) && (pos % T_BIT_SIZE != 0)) {
+      const size_t k = std::min(n, T_BIT_SIZE - pos % T_BIT_SIZE);
+      deposit(data, pos, k, value ? static_cast<T>(low_mask(k)) : T(0));
+      pos += k;
+      n -= k;
+    }
+
+    T* out = data + pos / T_BIT_SIZE;
+    std::fill(out, out + n / T_BIT_SIZE, value ? ones : T(0));
+
+    const size_t rest = n % T_BIT_SIZE;
+    if (rest != 0) {
+      deposit(data, pos + n - rest, rest,
+              value ? static_cast<T>(low_mask(rest)) : T(0));
+    }
+  }
+
+  static size_t count(const T* data, size_t pos, size_t n) noexcept {
+    size_t ones = 0;
+    if ((n != 0) && (pos % T_BIT_SIZE != 0)) {
+      const size_t k = std::min(n, T_BIT_SIZE - pos % T_BIT_SIZE);
+      ones += popcount(uint64_t(extract(data, pos, k)));
+      pos += k;
+      n -= k;
+    }
+
+    ones += popcount(reinterpret_cast<const unsigned char*>(
+                         data + pos / T_BIT_SIZE),
+                     sizeof(T) * (n / T_BIT_SIZE));
+
+    const size_t rest = n % T_BIT_SIZE;
+    if (rest != 0) {
+      ones += popcount(uint64_t(extract(data, pos + n - rest, rest)));
+    }
+
+    return ones;
+  }
+
+  // offset of the first bit equal to value, or n
+  static size_t find(const T* data, size_t pos, size_t n, bool value) noexcept {
+    const uint64_t flip = value ? 0 : ~uint64_t(0);
+    size_t offset = 0;
+
+    while (offset < n) {
+      const size_t at = pos + offset;
+      const size_t k = std::min(n - offset, T_BIT_SIZE - at % T_BIT_SIZE);
+      const uint64_t field = (extract(data, at, k) ^ flip) & low_mask(k);
+      if (field != 0) {
+        return offset + first_in_field(field, k);
+      }
+      offset += k;
+    }
+
+    return n;
+  }
+
+  static bool equal(const T* a, size_t apos, const T* b, size_t bpos,
+                    size_t n) noexcept {
+    size_t offset = 0;
+    for (; offset + T_BIT_SIZE <= n; offset += T_BIT_SIZE) {
+      if (extract(a, apos + offset, T_BIT_SIZE) !=
+          extract(b, bpos + offset, T_BIT_SIZE)) {
+        return false;
+      }
+    }
+
+    const size_t rest = n - offset;
+    return (rest == 0) || (extract(a, apos + offset, rest) ==
+                           extract(b, bpos + offset, rest));
+  }
+};
+/**
+ * @brief Vector of trivially copyable elements that keeps up to
+ * INLINE_COUNT of them in the object itself, so short buffers never touch
+ * the allocator. Only the part of the std::vector interface bit uses.
+ */
+template <class T, size_t INLINE_COUNT, class ALLOCATOR>
+class small_buffer : private ALLOCATOR {
  public:
-  typedef BUFFER_ELEMENT_TYPE value_type;
-  typedef BUFFER_ELEMENT_TYPE& reference;
-  typedef const BUFFER_ELEMENT_TYPE& const_reference;
+  typedef T value_type;
+  typedef ALLOCATOR allocator_type;
   typedef size_t size_type;
-  typedef std::vector<value_type> container_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+ public:
+  small_buffer() noexcept(noexcept(ALLOCATOR())) : ALLOCATOR() {}
+  explicit small_buffer(const ALLOCATOR& allocator) noexcept
+      : ALLOCATOR(allocator) {}
+  small_buffer(const small_buffer& x)
+      : ALLOCATOR(traits::select_on_container_copy_construction(
+            x.get_allocator())) {
+    assign(x.data_, x.size_);
+  }
+  small_buffer(small_buffer&& x) noexcept : ALLOCATOR(x.get_allocator()) {
+    take(x);
+  }
+  ~small_buffer() { release(); }
+
+  small_buffer& operator=(const small_buffer& x) {
+    if (this != &x) {
+      if constexpr (traits::propagate_on_container_copy_assignment::value) {
+        release();
+        allocator() = x.get_allocator();
+      }
+      assign(x.data_, x.size_);
+    }
+    return *this;
+  }
+
+  small_buffer& operator=(small_buffer&& x) noexcept(
+      traits::propagate_on_container_move_assignment::value ||
+      traits::is_always_equal::value) {
+    if (this == &x) {
+      return *this;
+    }
+
+    if constexpr (traits::propagate_on_container_move_assignment::value) {
+      release();
+      allocator() = std::move(x.allocator());
+      take(x);
+    } else {
+      if (allocator() == x.allocator()) {
+        release();
+        take(x);
+      } else {
+        // storage from another allocator can not be adopted
+        assign(x.data_, x.size_);
+        x.clear();
+      }
+    }
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept { return *this; }
+
+  iterator begin() noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+  T& operator[](size_type n) noexcept { return data_[n]; }
+  const T& operator[](size_type n) const noexcept { return data_[n]; }
+  T& back() noexcept { return data_[size_ - 1]; }
+  const T& back() const noexcept { return data_[size_ - 1]; }
+
+  T& at(size_type n) {
+    if (n >= size_) {
+      throw std::out_of_range("buffer access is out of range.");
+    }
+    return data_[n];
+  }
+
+  void reserve(size_type n) {
+    if (n > capacity_) {
+      reallocate(n);
+    }
+  }
+
+  void resize(size_type n) { resize(n, T()); }
+
+  void resize(size_type n, const T& value) {
+    if (n > capacity_) {
+      reallocate(std::max(n, 2 * capacity_));
+    }
+    if (n > size_) {
+      std::fill(data_ + size_, data_ + n, value);
+    }
+    size_ = n;
+  }
+
+  void push_back(const T& value) {
+    resize(size_ + 1, value);
+  }
+
+  void pop_back() noexcept { size_--; }
+
+  void clear() noexcept { size_ = 0; }
+
+  // only appending at end() is supported
+  iterator insert(const_iterator position, const T* first, const T* last) {
+    const size_type offset = static_cast<size_type>(position - data_);
+    const size_type n = static_cast<size_type>(last - first);
+    if (size_ + n > capacity_) {
+      reallocate(std::max(size_ + n, 2 * capacity_));
+    }
+    if (n != 0) {
+      std::memcpy(data_ + size_, first, n * sizeof(T));
+    }
+    size_ += n;
+    return data_ + offset;
+  }
+
+ private:
+  typedef std::allocator_traits<ALLOCATOR> traits;
+
+  ALLOCATOR& allocator() noexcept { return *this; }
+
+  bool is_inline() const noexcept { return data_ == inline_; }
+
+  void assign(const T* data, size_type n) {
+    size_ = 0;
+    reserve(n);
+    if (n != 0) {
+      std::memcpy(data_, data, n * sizeof(T));
+    }
+    size_ = n;
+  }
+
+  // steal the heap storage of x, or copy its inline elements
+  void take(small_buffer& x) noexcept {
+    if (x.is_inline()) {
+      std::memcpy(inline_, x.inline_, x.size_ * sizeof(T));
+      data_ = inline_;
+      capacity_ = INLINE_COUNT;
+    } else {
+      data_ = x.data_;
+      capacity_ = x.capacity_;
+    }
+    size_ = x.size_;
+
+    x.data_ = x.inline_;
+    x.size_ = 0;
+    x.capacity_ = INLINE_COUNT;
+  }
+
+  void reallocate(size_type n) {
+    T* data = traits::allocate(allocator(), n);
+    if (size_ != 0) {
+      std::memcpy(data, data_, size_ * sizeof(T));
+    }
+    release();
+    data_ = data;
+    capacity_ = n;
+  }
+
+  void release() noexcept {
+    if (!is_inline()) {
+      traits::deallocate(allocator(), data_, capacity_);
+      data_ = inline_;
+      capacity_ = INLINE_COUNT;
+    }
+  }
+
+ private:
+  T* data_ = inline_;
+  size_type size_ = 0;
+  size_type capacity_ = INLINE_COUNT;
+  T inline_[INLINE_COUNT];
+};
+}  // namespace detail
+
+/**
+ * @brief Proxy for one bit, returned by dereferencing a non-const iterator.
+ */
+template <class BUFFER_ELEMENT_TYPE, bool MSB_TO_LSB>
+class bit_reference {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+
+ public:
+  bit_reference(value_type* element, value_type mask) noexcept;
+  bit_reference(const bit_reference& x) = default;
+
+  bit_reference& operator=(value_type value);
+  bit_reference& operator=(const bit_reference& x);
+  operator value_type() const noexcept;
+  void flip() noexcept;
+
+ private:
+  value_type* element_;
+  value_type mask_;
+};
+
+/**
+ * @brief Random access iterator over the bits of a buffer.
+ *
+ * It is an element pointer plus a bit position, so the algorithm overloads
+ * below can work on whole elements.
+ */
+template <class BUFFER_ELEMENT_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+class bit_iterator {
+ public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef void pointer;
+  typedef typename std::conditional<
+      IS_CONST, BUFFER_ELEMENT_TYPE,
+      bit_reference<BUFFER_ELEMENT_TYPE, MSB_TO_LSB>>::type reference;
+  typedef typename std::conditional<IS_CONST, const BUFFER_ELEMENT_TYPE*,
+                                    BUFFER_ELEMENT_TYPE*>::type element_pointer;
+
+ public:
+  bit_iterator() noexcept = default;
+  bit_iterator(element_pointer data, size_t position) noexcept;
+  template <bool OTHER_IS_CONST,
+            class = typename std::enable_if<IS_CONST && !OTHER_IS_CONST>::type>
+  bit_iterator(
+      const bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, OTHER_IS_CONST>& x)
+      noexcept;
+
+  reference operator*() const noexcept;
+  reference operator[](difference_type n) const noexcept;
+  bit_iterator& operator++() noexcept;
+  bit_iterator operator++(int) noexcept;
+  bit_iterator& operator--() noexcept;
+  bit_iterator operator--(int) noexcept;
+  bit_iterator& operator+=(difference_type n) noexcept;
+  bit_iterator& operator-=(difference_type n) noexcept;
+  bit_iterator operator+(difference_type n) const noexcept;
+  bit_iterator operator-(difference_type n) const noexcept;
+  difference_type operator-(const bit_iterator& x) const noexcept;
+
+  bool operator==(const bit_iterator& x) const noexcept;
+  bool operator!=(const bit_iterator& x) const noexcept;
+  bool operator<(const bit_iterator& x) const noexcept;
+  bool operator>(const bit_iterator& x) const noexcept;
+  bool operator<=(const bit_iterator& x) const noexcept;
+  bool operator>=(const bit_iterator& x) const noexcept;
+
+  element_pointer data() const noexcept;
+  size_t position() const noexcept;
+
+ private:
+  element_pointer data_ = nullptr;
+  size_t position_ = 0;
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>::bit_reference(
+    value_type* element, value_type mask) noexcept
+    : element_(element), mask_(mask) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>&
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>::operator=(value_type value) {
+  if ((value != value_type(0)) && (value != value_type(1))) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  if (value == value_type(1)) {
+    *element_ |= mask_;
+  } else {
+    *element_ &= static_cast<value_type>(~mask_);
+  }
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>&
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>::operator=(
+    const bit_reference& x) {
+  return *this = static_cast<value_type>(x);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>::operator value_type() const
+    noexcept {
+  return (*element_ & mask_) == value_type(0) ? value_type(0) : value_type(1);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+void bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB>::flip() noexcept {
+  *element_ ^= mask_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+void swap(bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB> x,
+          bit_reference<BIT_CONTAINER_TYPE, MSB_TO_LSB> y) {
+  const BIT_CONTAINER_TYPE value = x;
+  x = y;
+  y = value;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::bit_iterator(
+    element_pointer data, size_t position) noexcept
+    : data_(data), position_(position) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+template <bool OTHER_IS_CONST, class>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::bit_iterator(
+    const bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, OTHER_IS_CONST>& x)
+    noexcept
+    : data_(x.data()), position_(x.position()) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+typename bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::reference
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator*() const
+    noexcept {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+  const size_t e = position_ / range::T_BIT_SIZE;
+  const BIT_CONTAINER_TYPE mask = range::mask(position_ % range::T_BIT_SIZE);
+
+  if constexpr (IS_CONST) {
+    return (data_[e] & mask) == 0 ? BIT_CONTAINER_TYPE(0)
+                                  : BIT_CONTAINER_TYPE(1);
+  } else {
+    return reference(data_ + e, mask);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+typename bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::reference
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator[](
+        difference_type n) const noexcept {
+  return *(*this + n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>&
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator++() noexcept {
+  position_++;
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator++(
+    int) noexcept {
+  bit_iterator old(*this);
+  position_++;
+  return old;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>&
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator--() noexcept {
+  position_--;
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator--(
+    int) noexcept {
+  bit_iterator old(*this);
+  position_--;
+  return old;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>&
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator+=(
+    difference_type n) noexcept {
+  position_ += n;
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>&
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator-=(
+    difference_type n) noexcept {
+  position_ -= n;
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator+(
+    difference_type n) const noexcept {
+  return bit_iterator(data_, position_ + n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator-(
+    difference_type n) const noexcept {
+  return bit_iterator(data_, position_ - n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+typename bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::difference_type
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator-(
+    const bit_iterator& x) const noexcept {
+  return static_cast<difference_type>(position_) -
+         static_cast<difference_type>(x.position_);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> operator+(
+    typename bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                          IS_CONST>::difference_type n,
+    const bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>& x) noexcept {
+  return x + n;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator==(
+    const bit_iterator& x) const noexcept {
+  return position_ == x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator!=(
+    const bit_iterator& x) const noexcept {
+  return position_ != x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator<(
+    const bit_iterator& x) const noexcept {
+  return position_ < x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator>(
+    const bit_iterator& x) const noexcept {
+  return position_ > x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator<=(
+    const bit_iterator& x) const noexcept {
+  return position_ <= x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bool bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::operator>=(
+    const bit_iterator& x) const noexcept {
+  return position_ >= x.position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+typename bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::element_pointer
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::data() const noexcept {
+  return data_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+size_t bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST>::position() const
+    noexcept {
+  return position_;
+}
+
+/**
+ * @brief Whole-element versions of std::copy, std::fill, std::count,
+ * std::find and std::equal for bit iterators.
+ *
+ * They are found by argument dependent lookup, so unqualified calls (or
+ * calls after "using std::copy;") pick them over the per-bit std versions.
+ */
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, false> copy(
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> first,
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> last,
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, false> result) {
+  const size_t n = static_cast<size_t>(last - first);
+  detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::copy(
+      result.data(), result.position(), first.data(), first.position(), n);
+  return result + static_cast<std::ptrdiff_t>(n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class VALUE_TYPE>
+void fill(bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, false> first,
+          bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, false> last,
+          const VALUE_TYPE& value) {
+  if ((value != VALUE_TYPE(0)) && (value != VALUE_TYPE(1))) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::fill(
+      first.data(), first.position(), static_cast<size_t>(last - first),
+      value == VALUE_TYPE(1));
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST,
+          class VALUE_TYPE>
+std::ptrdiff_t count(
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> first,
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> last,
+    const VALUE_TYPE& value) {
+  const size_t n = static_cast<size_t>(last - first);
+  const size_t ones = detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::count(
+      first.data(), first.position(), n);
+
+  if (value == VALUE_TYPE(1)) {
+    return static_cast<std::ptrdiff_t>(ones);
+  }
+  return value == VALUE_TYPE(0) ? static_cast<std::ptrdiff_t>(n - ones) : 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST,
+          class VALUE_TYPE>
+bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> find(
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> first,
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> last,
+    const VALUE_TYPE& value) {
+  if ((value != VALUE_TYPE(0)) && (value != VALUE_TYPE(1))) {
+    return last;
+  }
+
+  const size_t offset = detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::find(
+      first.data(), first.position(), static_cast<size_t>(last - first),
+      value == VALUE_TYPE(1));
+  return first + static_cast<std::ptrdiff_t>(offset);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, bool IS_CONST1,
+          bool IS_CONST2>
+bool equal(bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST1> first1,
+           bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST1> last1,
+           bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST2> first2) {
+  return detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::equal(
+      first1.data(), first1.position(), first2.data(), first2.position(),
+      static_cast<size_t>(last1 - first1));
+}
+
+template <class BUFFER_ELEMENT_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+class bit_view;
+
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<BUFFER_ELEMENT_TYPE>,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class bit {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef bit_reference<BUFFER_ELEMENT_TYPE, MSB_TO_LSB> reference;
+  typedef BUFFER_ELEMENT_TYPE const_reference;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef ALLOCATOR allocator_type;
+
+  // up to INLINE_BIT_SIZE bits are stored without allocating
+  static constexpr size_t INLINE_BIT_SIZE = 128;
+  typedef detail::small_buffer<value_type,
+                               INLINE_BIT_SIZE / (8 * sizeof(value_type)),
+                               allocator_type>
+      container_type;
+  typedef bit_view<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, void> view_type;
+
+  static constexpr value_type ONE = value_type(1);
+  static constexpr value_type ZERO = value_type(0);
+  static constexpr value_type VALUE_MAX =
+      std::numeric_limits<value_type>::max();
+  static constexpr size_t T_BYTE_SIZE = sizeof(value_type);
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_type npos = static_cast<size_type>(-1);
+
+ private:
+  static constexpr value_type create_bit_pattern(size_t i) {
+    return ONE << (MSB_TO_LSB ? (T_BIT_SIZE - 1) - i : i);
+  }
+
+  template <size_t... i>
+  static constexpr auto create_bit_pattern_array(std::index_sequence<i...>) {
+    return std::array<value_type, sizeof...(i)>{{create_bit_pattern(i)...}};
+  }
+
+  static constexpr auto create_bit_pattern_array() {
+    return create_bit_pattern_array(std::make_index_sequence<T_BIT_SIZE>{});
+  }
+
+  static constexpr value_type create_mask_pattern(size_t i) {
+    value_type mask = ZERO;
+    for (size_t d = 0; d <= i; d++) mask |= create_bit_pattern(d);
+    return mask;
+  }
+
+  template <size_t... i>
+  static constexpr auto create_mask_pattern_array(std::index_sequence<i...>) {
+    return std::array<value_type, sizeof...(i)>{{create_mask_pattern(i)...}};
+  }
+
+  static constexpr auto create_mask_pattern_array() {
+    return create_mask_pattern_array(std::make_index_sequence<T_BIT_SIZE>{});
+  }
+
+ private:
+  /**
+   * @brief BIT_PATTERNS are
+   *
+   * For MSB to LSB,
+   *    "10000000", "01000000", "00100000", "00010000",  "00001000", "00000100",
+   *    "00000010", "00000001"
+   *
+   * For LSB to MSB,
+   *    "00000001", "00000010", "00000100", "00001000",  "00010000", "00100000",
+   *    "01000000", "10000000"
+   */
+  static constexpr auto BIT_PATTERNS = create_bit_pattern_array();
+
+  /**
+   * @brief MASK_PATTERNS are
+   *
+   * For MSB to LSB,
+   *    "10000000", "11000000", "11100000", "11110000",  "11111000", "11111100",
+   *    "11111110", "11111111"
+   *
+   * For LSB to MSB,
+   *    "00000001", "00000011", "00000111", "00001111",  "00011111", "00111111",
+   *    "01111111", "11111111"
+   */
+  static constexpr auto MASK_PATTERNS = create_mask_pattern_array();
+
+ public:
+  typedef bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, false> iterator;
+  typedef bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, true> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+ public:
+  // constructor
+  bit();
+
+  explicit bit(const allocator_type& allocator);
+  explicit bit(size_type n);
+  bit(size_type n, const value_type& val);
+  bit(const bit& x);
+  bit(bit&& x);
+  bit(std::initializer_list<value_type> il);
+  bit(const value_type* data, size_type size);
+
+  template <class InputIterator,
+            class = typename std::enable_if<
+                !std::is_integral<InputIterator>::value>::type>
+  bit(InputIterator first, InputIterator last);
+
+  /**
+   * @brief The same bits from a bit of another element type, order or
+   * allocator. Whole words are shuffled and bit reversed rather than
+   * copied a bit at a time.
+   */
+  template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB, class OTHER_ALLOCATOR,
+            class OTHER_CHECK,
+            class = typename std::enable_if<!std::is_same<
+                bit, bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR,
+                         OTHER_CHECK>>::value>::type>
+  explicit bit(const bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR,
+                         OTHER_CHECK>& x);
+
+  // destructor
+  ~bit();
+
+  allocator_type get_allocator() const noexcept;
+
+  // assignment operator
+  bit& operator=(const bit& x);
+  bit& operator=(bit&& x);
+  bit& operator=(std::initializer_list<value_type> il);
+  template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB, class OTHER_ALLOCATOR,
+            class OTHER_CHECK,
+            class = typename std::enable_if<!std::is_same<
+                bit, bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR,
+                         OTHER_CHECK>>::value>::type>
+  bit& operator=(const bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR,
+                           OTHER_CHECK>& x);
+
+  // concatenate operator
+  bit& operator+=(const bit& x);
+
+  // iterator, the non-const ones drop the rank index like data()
+  iterator begin();
+  iterator end();
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+  reverse_iterator rbegin();
+  reverse_iterator rend();
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator rend() const noexcept;
+  const_reverse_iterator crbegin() const noexcept;
+  const_reverse_iterator crend() const noexcept;
+
+  // capacity
+  size_type size() const noexcept;
+  void resize(size_type n);
+  void resize(size_type n, const value_type& val);
+  void reserve(size_type n);
+  size_type buffer_element_count() const noexcept;
+  size_type buffer_element_size() const noexcept;
+  bool empty() const noexcept;
+
+  // element access
+  value_type operator[](size_type n) const;
+  value_type at(size_type n) const;
+  value_type front() const noexcept;
+  value_type back() const noexcept;
+  const value_type* data() const noexcept;
+  value_type* data() noexcept;
+
+  /**
+   * @brief View of the bits in [begin, end) without copying them. The view
+   * is invalidated by anything that invalidates data().
+   */
+  view_type sub_range(size_type begin, size_type end) const;
+
+  /**
+   * @brief Rank and select.
+   *
+   * rank1(n) is the number of ones in [0, n), select1(k) the position of the
+   * one with rank k. They use an index of 64-bit counts per 4096 bits and
+   * 16-bit counts per 512 bits (under 5% of the buffer), built on first use
+   * and dropped by any modifier or by the non-const data(). Building is not
+   * thread safe, call build_rank_index() before sharing a const bit.
+   */
+  size_type rank1(size_type n) const;
+  size_type rank0(size_type n) const;
+  size_type select1(size_type k) const;
+  size_type select0(size_type k) const;
+  void build_rank_index() const;
+
+  /**
+   * @brief Build the rank index through parallel_for(n, f), which has to
+   * call f(begin, end) on ranges covering superblocks [0, n), from any
+   * number of threads, and return once every call is done.
+   */
+  template <class PARALLEL_FOR>
+  void build_rank_index(PARALLEL_FOR parallel_for) const;
+
+  // bitwise operations, both sides must have the same size
+  bit& operator&=(const bit& x);
+  bit& operator|=(const bit& x);
+  bit& operator^=(const bit& x);
+  bit& andnot(const bit& x);
+  bit& operator&=(const view_type& x);
+  bit& operator|=(const view_type& x);
+  bit& operator^=(const view_type& x);
+  bit& andnot(const view_type& x);
+  bit& flip() noexcept;
+  bit operator~() const;
+  size_type count() const noexcept;
+  bool any() const noexcept;
+  bool none() const noexcept;
+  bool all() const noexcept;
+
+  /**
+   * @brief Search for set (or zero) bits a whole element at a time.
+   *
+   * find_next(pos) looks after pos. All searches return npos when nothing
+   * is found. for_each_set_bit(f) calls f(position) for every one in order.
+   */
+  size_type find_first() const noexcept;
+  size_type find_next(size_type pos) const noexcept;
+  size_type find_last() const noexcept;
+  size_type find_first_zero() const noexcept;
+  size_type find_next_zero(size_type pos) const noexcept;
+  size_type find_last_zero() const noexcept;
+  template <class FUNCTION>
+  void for_each_set_bit(FUNCTION f) const;
+
+  // modifiers
+  void push(value_type value);
+
+  /**
+   * @brief Push the low nbits (0 to 64) of value in one step.
+   *
+   * For MSB to LSB the most significant of the nbits goes first, for LSB to
+   * MSB the least significant one does, so a field lands in the buffer the
+   * way the buffer element orders its own bits.
+   */
+  void push_bits(uint64_t value, unsigned nbits);
+  void pop();
+  void replace(size_type position, value_type value);
+  void align(value_type value = ZERO);
+  void push_byte(unsigned char value);
+
+  /**
+   * @brief Push n bytes, a whole buffer element at a time.
+   *
+   * Every byte goes in as push_bits(byte, 8), so inside a wide element the
+   * bytes are packed big-endian for MSB to LSB (the first byte is the most
+   * significant) and little-endian for LSB to MSB, whatever the host order.
+   */
+  void push_bytes(const unsigned char* data, size_type n);
+  template <class InputIterator>
+  void push_bytes(InputIterator first, InputIterator last);
+
+  /**
+   * @brief Push an unsigned (ue) or signed (se) Exp-Golomb code.
+   *
+   * The code is a run of zeros, a one and then the info bits as a push_bits()
+   * field. For MSB to LSB this is the ue(v)/se(v) layout of H.264/HEVC.
+   */
+  void push_ue(uint64_t value);
+  void push_se(int64_t value);
+
+  /**
+   * @brief Append all bits of x, a whole element at a time. When this ends
+   * mid-element each element of x is shifted across the seam once.
+   */
+  bit& append(const bit& x);
+
+  /**
+   * @brief Insert the bits of x (or a push_bits() field) before position.
+   * The bits from position on move towards the back a whole element at a
+   * time, each element shifted once across the seam.
+   */
+  bit& insert(size_type position, const bit& x);
+  bit& insert(size_type position, uint64_t value, unsigned nbits);
+
+  // remove bits [first, last), the bits after them move to first
+  bit& erase(size_type first, size_type last);
+
+  /**
+   * @brief Shift all bits like one big value_type, the size is kept and
+   * the vacated bits are zero. For MSB to LSB << moves bits towards the
+   * front, for LSB to MSB towards the back, as it does inside an element.
+   */
+  bit& operator<<=(size_type n);
+  bit& operator>>=(size_type n);
+
+  void clear() noexcept;
+
+ private:
+  inline void push_with_resize(value_type value);
+  inline void pop_with_resize();
+  inline void append_elements(const value_type* data, size_type n);
+  inline value_type bit_value_at(size_type position) const;
+  inline value_type bit_value(size_type position) const;
+  inline size_type bit_count() const noexcept;
+  inline size_type bit_remainder() noexcept;
+  inline void initialize_from(const std::initializer_list<value_type>& type);
+  template <class InputIterator>
+  inline void initialize_from(InputIterator first, InputIterator last);
+  template <bool IS_CONST>
+  inline void initialize_from(
+      bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, IS_CONST> first,
+      bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, IS_CONST> last);
+  template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB>
+  inline void transcode_from(const OTHER_TYPE* data, size_type size);
+  inline void invalidate_rank_index() noexcept;
+  inline void clear_padding() noexcept;
+  inline void shift_towards_front(size_type n) noexcept;
+  inline void shift_towards_back(size_type n) noexcept;
+  template <detail::bitwise_op OP>
+  inline void apply(const bit& x);
+  template <detail::bitwise_op OP>
+  inline void apply(const value_type* data, size_type pos, size_type n);
+  template <bool FIND_ONE>
+  inline size_type find_from(size_type pos) const noexcept;
+  template <bool FIND_ONE>
+  inline size_type find_last_of() const noexcept;
+  template <bool FIND_ONE>
+  inline size_type skip_elements(size_type e) const noexcept;
+  static inline size_type first_in_element(value_type element) noexcept;
+  static inline size_type last_in_element(value_type element) noexcept;
+  inline size_type rank_zeros_before(size_type superblock) const noexcept;
+  inline size_type select_in_element(value_type element, size_type k) const
+      noexcept;
+
+ private:
+  static constexpr size_type RANK_BLOCK_BIT_SIZE = 512;
+  static constexpr size_type RANK_SUPERBLOCK_BIT_SIZE = 4096;
+  static constexpr size_type RANK_BLOCKS_PER_SUPERBLOCK =
+      RANK_SUPERBLOCK_BIT_SIZE / RANK_BLOCK_BIT_SIZE;
+  static constexpr size_type SELECT_SAMPLE_RATE = 8192;
+
+  template <class U>
+  using rebind_allocator =
+      typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<U>;
+
+  // drawn from the buffer's allocator on the first rank or select
+  struct rank_index {
+    explicit rank_index(const allocator_type& allocator)
+        : superblocks(rebind_allocator<uint64_t>(allocator)),
+          blocks(rebind_allocator<uint16_t>(allocator)),
+          ones_samples(rebind_allocator<size_type>(allocator)),
+          zeros_samples(rebind_allocator<size_type>(allocator)) {}
+
+    // ones before each superblock, plus the total at the end
+    std::vector<uint64_t, rebind_allocator<uint64_t>> superblocks;
+    // ones from the start of the superblock to each block
+    std::vector<uint16_t, rebind_allocator<uint16_t>> blocks;
+    // superblock holding every SELECT_SAMPLE_RATE-th one (zero)
+    std::vector<size_type, rebind_allocator<size_type>> ones_samples;
+    std::vector<size_type, rebind_allocator<size_type>> zeros_samples;
+    bool valid = false;
+  };
+
+  typedef rebind_allocator<rank_index> rank_index_allocator;
+  typedef std::allocator_traits<rank_index_allocator> rank_index_traits;
+
+  inline rank_index& allocate_rank_index() const;
+  inline void release_rank_index() noexcept;
+
+ private:
+  container_type buffer_;
+  value_type* last_byte_holder_ = nullptr;
+  size_type next_bit_position_ = T_BIT_SIZE;
+  mutable rank_index* rank_index_ = nullptr;
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator+(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> concat;
+
+  concat.reserve(lhs.size() + rhs.size());
+  concat.append(lhs);
+  concat.append(rhs);
+
+  return concat;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator&(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> result(lhs);
+  result &= rhs;
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator|(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> result(lhs);
+  result |= rhs;
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator^(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> result(lhs);
+  result ^= rhs;
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator<<(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    size_t n) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> result(lhs);
+  result <<= n;
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> operator>>(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>& lhs,
+    size_t n) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK> result(lhs);
+  result >>= n;
+  return result;
+}
+
+#if __has_include(<memory_resource>)
+namespace pmr {
+/**
+ * @brief bit drawing its buffer from a std::pmr::memory_resource, e.g. a
+ * monotonic arena reset once per batch of packets.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true>
+using bit = jcy::bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB,
+                     std::pmr::polymorphic_allocator<BUFFER_ELEMENT_TYPE>>;
+}  // namespace pmr
+#endif
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit() {
+  clear();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    const allocator_type& allocator)
+    : buffer_(allocator) {
+  clear();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(size_type n) {
+  resize(n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    size_type n, const value_type& val) {
+  resize(n, val);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(const bit& x)
+    : buffer_(x.buffer_),
+      last_byte_holder_(buffer_.empty() ? nullptr : &(buffer_.back())),
+      next_bit_position_(x.next_bit_position_) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(bit&& x)
+    : buffer_(std::move(x.buffer_)),
+      last_byte_holder_(buffer_.empty() ? nullptr : &(buffer_.back())),
+      next_bit_position_(x.next_bit_position_) {
+  x.clear();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    std::initializer_list<value_type> il) {
+  initialize_from(il);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    const value_type* data, size_type size) {
+  resize(size);
+  if (size != 0) {
+    std::memcpy(buffer_.data(), data, T_BYTE_SIZE * buffer_element_count());
+  }
+
+  // clean up tail if necessary
+  clear_padding();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class InputIterator, class>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    InputIterator first, InputIterator last) {
+  initialize_from(first, last);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB, class OTHER_ALLOCATOR,
+          class OTHER_CHECK, class>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit(
+    const bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR, OTHER_CHECK>& x) {
+  transcode_from<OTHER_TYPE, OTHER_MSB_TO_LSB>(x.data(), x.size());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::~bit() {
+  release_rank_index();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::allocator_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::get_allocator()
+    const noexcept {
+  return buffer_.get_allocator();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator=(
+    const bit& x) {
+  // the index was drawn from the allocator the buffer may be about to drop
+  release_rank_index();
+  buffer_ = x.buffer_;
+  last_byte_holder_ = buffer_.empty() ? nullptr : &(buffer_.back());
+  next_bit_position_ = x.next_bit_position_;
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator=(bit&& x) {
+  release_rank_index();
+  buffer_ = std::move(x.buffer_);
+  // inline elements were copied, so the last one has moved
+  last_byte_holder_ = buffer_.empty() ? nullptr : &(buffer_.back());
+  next_bit_position_ = x.next_bit_position_;
+  x.clear();
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator=(
+    std::initializer_list<value_type> il) {
+  initialize_from(il);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB, class OTHER_ALLOCATOR,
+          class OTHER_CHECK, class>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator=(
+    const bit<OTHER_TYPE, OTHER_MSB_TO_LSB, OTHER_ALLOCATOR, OTHER_CHECK>& x) {
+  transcode_from<OTHER_TYPE, OTHER_MSB_TO_LSB>(x.data(), x.size());
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator+=(
+    const bit& x) {
+  return append(x);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::begin() {
+  invalidate_rank_index();
+  return iterator(buffer_.data(), 0);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::end() {
+  invalidate_rank_index();
+  return iterator(buffer_.data(), bit_count());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::begin() const
+    noexcept {
+  return const_iterator(buffer_.data(), 0);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::end() const
+    noexcept {
+  return const_iterator(buffer_.data(), bit_count());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::cbegin() const
+    noexcept {
+  return begin();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::cend() const
+    noexcept {
+  return end();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rbegin() {
+  return reverse_iterator(end());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rend() {
+  return reverse_iterator(begin());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rbegin() const
+    noexcept {
+  return const_reverse_iterator(end());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rend() const
+    noexcept {
+  return const_reverse_iterator(begin());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::crbegin() const
+    noexcept {
+  return rbegin();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+             TYPE_CHECK>::const_reverse_iterator
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::crend() const
+    noexcept {
+  return rend();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::push_with_resize(value_type value) {
+  invalidate_rank_index();
+
+  if ((value != ZERO) && (value != ONE)) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  if (next_bit_position_ == T_BIT_SIZE) {
+    buffer_.resize(buffer_.size() + 1);
+    last_byte_holder_ = &(buffer_.back());
+    *(last_byte_holder_) = ZERO;
+    next_bit_position_ = 0;
+  }
+
+  if (value == ONE) {
+    *(last_byte_holder_) =
+        *(last_byte_holder_) | BIT_PATTERNS[next_bit_position_];
+  }
+
+  next_bit_position_++;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::pop_with_resize() {
+  invalidate_rank_index();
+
+  next_bit_position_--;
+
+  // keep unused bits zero
+  *last_byte_holder_ &= ~BIT_PATTERNS[next_bit_position_];
+
+  // never leave an empty last element behind
+  if (next_bit_position_ == 0) {
+    buffer_.pop_back();
+    last_byte_holder_ = buffer_.empty() ? nullptr : &(buffer_.back());
+    next_bit_position_ = T_BIT_SIZE;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::append_elements(const value_type* data, size_type n) {
+  invalidate_rank_index();
+
+  if (n == 0) {
+    return;
+  }
+
+  const size_type count = (n + T_BIT_SIZE - 1) / T_BIT_SIZE;
+  const size_type total = bit_count() + n;
+
+  if (next_bit_position_ == T_BIT_SIZE) {
+    buffer_.insert(buffer_.end(), data, data + count);
+  } else {
+    const size_type shift = next_bit_position_;
+    const size_type first = buffer_.size() - 1;
+    buffer_.resize(first + count + 1);
+
+    value_type* out = buffer_.data() + first;
+    for (size_type i = 0; i < count; i++) {
+      const value_type word = data[i];
+      if (MSB_TO_LSB) {
+        out[i] |= static_cast<value_type>(word >> shift);
+        out[i + 1] = static_cast<value_type>(word << (T_BIT_SIZE - shift));
+      } else {
+        out[i] |= static_cast<value_type>(word << shift);
+        out[i + 1] = static_cast<value_type>(word >> (T_BIT_SIZE - shift));
+      }
+    }
+  }
+
+  buffer_.resize((total + T_BIT_SIZE - 1) / T_BIT_SIZE);
+  last_byte_holder_ = &(buffer_.back());
+  next_bit_position_ =
+      (total % T_BIT_SIZE) == 0 ? T_BIT_SIZE : (total % T_BIT_SIZE);
+
+  // keep unused bits zero
+  clear_padding();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::clear()
+    noexcept {
+  invalidate_rank_index();
+  buffer_.clear();
+  last_byte_holder_ = nullptr;
+  next_bit_position_ = T_BIT_SIZE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit_value_at(
+    size_type position) const {
+  if (position >= (buffer_.size() - 1) * T_BIT_SIZE + next_bit_position_) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  return bit_value(position);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit_value(
+    size_type position) const {
+  size_type byte_position = position / T_BIT_SIZE;
+  size_type bit_position = position % T_BIT_SIZE;
+  value_type byte = buffer_.operator[](byte_position);
+  return (byte & BIT_PATTERNS[bit_position]) == ZERO ? ZERO : ONE;
+  // return (byte >>
+  //         (MSB_TO_LSB ? ((T_BIT_SIZE - 1) - bit_position) : bit_position)) &
+  //        ONE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit_count() const
+    noexcept {
+  return (buffer_.size() - 1) * T_BIT_SIZE + next_bit_position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::bit_remainder()
+    noexcept {
+  return T_BIT_SIZE - next_bit_position_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::initialize_from(
+    const std::initializer_list<value_type>& il) {
+  clear();
+  reserve(il.size());
+
+  // gather up to 64 values into one push_bits() field
+  uint64_t field = 0;
+  unsigned n = 0;
+  for (const value_type& value : il) {
+    if ((value != ZERO) && (value != ONE)) {
+      throw std::invalid_argument("input argument is not one or zero.");
+    }
+
+    field |= MSB_TO_LSB ? uint64_t(value) << (63 - n) : uint64_t(value) << n;
+    if (++n == 64) {
+      push_bits(field, 64);
+      field = 0;
+      n = 0;
+    }
+  }
+
+  if (n != 0) {
+    push_bits(MSB_TO_LSB ? field >> (64 - n) : field, n);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class InputIterator>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::initialize_from(InputIterator first, InputIterator last) {
+  clear();
+  for (; first != last; ++first) {
+    push(static_cast<value_type>(*first));
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <bool IS_CONST>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::initialize_from(
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> first,
+    bit_iterator<BIT_CONTAINER_TYPE, MSB_TO_LSB, IS_CONST> last) {
+  const size_type n = static_cast<size_type>(last - first);
+  resize(n);
+  detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::copy(
+      buffer_.data(), 0, first.data(), first.position(), n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class OTHER_TYPE, bool OTHER_MSB_TO_LSB>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::transcode_from(
+    const OTHER_TYPE* data, size_type size) {
+  // resize() would keep the old bits for nothing
+  clear();
+  if (size != 0) {
+    resize(size);
+    detail::bit_transcode<OTHER_TYPE, OTHER_MSB_TO_LSB, value_type,
+                          MSB_TO_LSB>::copy(buffer_.data(), data, size);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size() const
+    noexcept {
+  return bit_count();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::reserve(
+    size_type n) {
+  buffer_.reserve((n + T_BIT_SIZE - 1) / T_BIT_SIZE);
+
+  // reallocation moves the last element
+  if (!buffer_.empty()) {
+    last_byte_holder_ = &(buffer_.back());
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::resize(
+    size_type n) {
+  invalidate_rank_index();
+
+  if (n == 0) {
+    clear();
+    return;
+  }
+
+  buffer_.resize((n + T_BIT_SIZE - 1) / T_BIT_SIZE);
+  last_byte_holder_ = &(buffer_.back());
+  next_bit_position_ = (n % T_BIT_SIZE) == 0 ? T_BIT_SIZE : (n % T_BIT_SIZE);
+
+  // keep unused bits zero when shrinking
+  clear_padding();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::resize(
+    size_type n, const value_type& value) {
+  invalidate_rank_index();
+
+  if ((value != ZERO) && (value != ONE)) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  const size_type old_size = bit_count();
+  resize(n);
+
+  if ((value == ONE) && (n > old_size)) {
+    // fill the tail of the old last element, then whole elements
+    size_type e = old_size / T_BIT_SIZE;
+    if (old_size % T_BIT_SIZE != 0) {
+      buffer_[e] |= static_cast<value_type>(
+          ~MASK_PATTERNS[old_size % T_BIT_SIZE - 1]);
+      e++;
+    }
+    std::fill(buffer_.begin() + e, buffer_.end(), VALUE_MAX);
+
+    // keep unused bits zero
+    clear_padding();
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+    TYPE_CHECK>::buffer_element_count() const noexcept {
+  return buffer_.size();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+    TYPE_CHECK>::buffer_element_size() const
+    noexcept {
+  return T_BYTE_SIZE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bool bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::empty() const
+    noexcept {
+  return bit_count() == 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+    bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator[](
+        size_type n) const {
+  return bit_value(n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::at(
+    size_type n) const {
+  return bit_value_at(n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::front() const
+    noexcept {
+  return (MSB_TO_LSB ? buffer_[0] >> (T_BIT_SIZE - 1) : buffer_[0]) & ONE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::back() const
+    noexcept {
+  return bit_value(bit_count() - 1);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+const typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+                   TYPE_CHECK>::value_type*
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::data() const
+    noexcept {
+  return buffer_.data();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::value_type*
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::data() noexcept {
+  invalidate_rank_index();
+  return buffer_.data();
+}
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push(
+    value_type value) {
+  push_with_resize(value);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_bits(
+    uint64_t value, unsigned nbits) {
+  invalidate_rank_index();
+
+  if (nbits > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  if (nbits < 64) {
+    value &= (uint64_t(1) << nbits) - 1;
+  }
+
+  while (nbits != 0) {
+    if (next_bit_position_ == T_BIT_SIZE) {
+      buffer_.push_back(ZERO);
+      last_byte_holder_ = &(buffer_.back());
+      next_bit_position_ = 0;
+    }
+
+    const unsigned room =
+        static_cast<unsigned>(T_BIT_SIZE - next_bit_position_);
+    const unsigned take = nbits < room ? nbits : room;
+
+    if (MSB_TO_LSB) {
+      // high bits of the field fill the low end of the current element
+      *last_byte_holder_ |=
+          static_cast<value_type>((value >> (nbits - take)) << (room - take));
+      nbits -= take;
+      value &= (uint64_t(1) << nbits) - 1;
+    } else {
+      // low bits of the field fill the high end of the current element
+      *last_byte_holder_ |=
+          static_cast<value_type>(value << next_bit_position_);
+      value = take == 64 ? 0 : value >> take;
+      nbits -= take;
+    }
+
+    next_bit_position_ += take;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::pop() {
+  pop_with_resize();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::replace(
+    size_type position, value_type value) {
+  invalidate_rank_index();
+  size_type byte_position = position / T_BIT_SIZE;
+  size_type bit_position = position % T_BIT_SIZE;
+
+  if (value == ONE) {
+    buffer_.at(byte_position) |= BIT_PATTERNS[bit_position];
+  }
+
+  if (value == ZERO) {
+    buffer_.at(byte_position) &= ~BIT_PATTERNS[bit_position];
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::align(
+    value_type value) {
+  int b = 0;
+  while (next_bit_position_ != T_BIT_SIZE) {
+    push((value & BIT_PATTERNS[b]) == ZERO ? ZERO : ONE);
+    b++;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_byte(
+    unsigned char value) {
+  invalidate_rank_index();
+
+  if (std::is_same<BIT_CONTAINER_TYPE, unsigned char>::value &&
+      (next_bit_position_ == T_BIT_SIZE)) {
+    buffer_.resize(buffer_.size() + 1);
+    last_byte_holder_ = &(buffer_.back());
+    *(last_byte_holder_) = value;
+  } else {
+    push_bits(value, 8);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_bytes(
+    const unsigned char* data, size_type n) {
+  invalidate_rank_index();
+
+  if (n == 0) {
+    return;
+  }
+
+  if (std::is_same<BIT_CONTAINER_TYPE, unsigned char>::value) {
+    append_elements(reinterpret_cast<const value_type*>(data), 8 * n);
+    return;
+  }
+
+  const size_type total = bit_count() + 8 * n;
+  const size_type count = (n + T_BYTE_SIZE - 1) / T_BYTE_SIZE;
+  const size_type whole = n / T_BYTE_SIZE;
+  const size_type shift = next_bit_position_ % T_BIT_SIZE;
+  value_type* out = buffer_.data() + buffer_.size() - (shift != 0 ? 1 : 0);
+
+  // grow once, then write each packed element straight into place
+  const size_type first = static_cast<size_type>(out - buffer_.data());
+  buffer_.resize((total + T_BIT_SIZE - 1) / T_BIT_SIZE);
+  out = buffer_.data() + first;
+  const size_type last = buffer_.size() - first;
+
+  for (size_type i = 0; i < count; i++) {
+    value_type word;
+    if (i < whole) {
+      word = detail::load_element<value_type, MSB_TO_LSB>(data +
+                                                           i * T_BYTE_SIZE);
+    } else {
+      unsigned char tail[T_BYTE_SIZE] = {};
+      std::memcpy(tail, data + i * T_BYTE_SIZE, n - i * T_BYTE_SIZE);
+      word = detail::load_element<value_type, MSB_TO_LSB>(tail);
+    }
+
+    if (shift == 0) {
+      out[i] = word;
+    } else if (MSB_TO_LSB) {
+      out[i] |= static_cast<value_type>(word >> shift);
+      if (i + 1 < last) {
+        out[i + 1] = static_cast<value_type>(word << (T_BIT_SIZE - shift));
+      }
+    } else {
+      out[i] |= static_cast<value_type>(word << shift);
+      if (i + 1 < last) {
+        out[i + 1] = static_cast<value_type>(word >> (T_BIT_SIZE - shift));
+      }
+    }
+  }
+
+  last_byte_holder_ = &(buffer_.back());
+  next_bit_position_ =
+      (total % T_BIT_SIZE) == 0 ? T_BIT_SIZE : (total % T_BIT_SIZE);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class InputIterator>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_bytes(
+    InputIterator first, InputIterator last) {
+  constexpr size_type CHUNK_BYTE_SIZE = 512;
+  unsigned char chunk[CHUNK_BYTE_SIZE];
+  size_type n = 0;
+
+  for (; first != last; ++first) {
+    chunk[n++] = static_cast<unsigned char>(*first);
+    if (n == CHUNK_BYTE_SIZE) {
+      push_bytes(chunk, n);
+      n = 0;
+    }
+  }
+
+  push_bytes(chunk, n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_ue(
+    uint64_t value) {
+  if (value == std::numeric_limits<uint64_t>::max()) {
+    throw std::invalid_argument("exp-golomb value is out of range.");
+  }
+
+  const uint64_t code = value + 1;
+  const unsigned len = 63 - detail::countl_zero(code);
+
+  // short codes go out as a single field
+  if (len < 32) {
+    if (MSB_TO_LSB) {
+      push_bits(code, 2 * len + 1);
+    } else {
+      push_bits(((code ^ (uint64_t(1) << len)) << (len + 1)) |
+                    (uint64_t(1) << len),
+                2 * len + 1);
+    }
+    return;
+  }
+
+  push_bits(0, len);
+  push_bits(1, 1);
+  push_bits(code, len);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::push_se(
+    int64_t value) {
+  if (value == std::numeric_limits<int64_t>::min()) {
+    throw std::invalid_argument("exp-golomb value is out of range.");
+  }
+
+  push_ue(value > 0 ? 2 * static_cast<uint64_t>(value) - 1
+                    : 2 * (0 - static_cast<uint64_t>(value)));
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::append(
+    const bit& x) {
+  if (&x == this) {
+    const bit copy(x);
+    append_elements(copy.buffer_.data(), copy.bit_count());
+  } else {
+    append_elements(x.buffer_.data(), x.bit_count());
+  }
+
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::insert(
+    size_type position, const bit& x) {
+  typedef detail::bit_range<value_type, MSB_TO_LSB> range;
+
+  const size_type old_size = bit_count();
+  if (position > old_size) {
+    throw std::out_of_range("bit insert is out of range.");
+  }
+
+  if (&x == this) {
+    const bit copy(x);
+    return insert(position, copy);
+  }
+
+  const size_type n = x.bit_count();
+  if (n == 0) {
+    return *this;
+  }
+
+  resize(old_size + n);
+  range::copy_backward(buffer_.data(), position + n, buffer_.data(), position,
+                       old_size - position);
+  range::copy(buffer_.data(), position, x.buffer_.data(), 0, n);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::insert(
+    size_type position, uint64_t value, unsigned nbits) {
+  if (nbits > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  // at most 64 bits, kept inline
+  bit field(buffer_.get_allocator());
+  field.push_bits(value, nbits);
+  return insert(position, field);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::erase(
+    size_type first, size_type last) {
+  typedef detail::bit_range<value_type, MSB_TO_LSB> range;
+
+  const size_type old_size = bit_count();
+  if ((first > last) || (last > old_size)) {
+    throw std::out_of_range("bit range is out of range.");
+  }
+
+  if (first == last) {
+    return *this;
+  }
+
+  range::copy(buffer_.data(), first, buffer_.data(), last, old_size - last);
+  resize(old_size - (last - first));
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator<<=(
+    size_type n) {
+  invalidate_rank_index();
+  if (MSB_TO_LSB) {
+    shift_towards_front(n);
+  } else {
+    shift_towards_back(n);
+  }
+  return *this;
+}
 
-  static const value_type ONE = value_type(1);
-  static const value_type ZERO = value_type(0);
-  static const value_type VALUE_MAX = std::numeric_limits<value_type>::max();
-  static const size_t T_BYTE_SIZE = sizeof(value_type);
-  static const size_t T_BIT_SIZE = 8 * sizeof(value_type);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator>>=(
+    size_type n) {
+  invalidate_rank_index();
+  if (MSB_TO_LSB) {
+    shift_towards_back(n);
+  } else {
+    shift_towards_front(n);
+  }
+  return *this;
+}
 
- public:
-  template <class A, bool B, class C>
-  friend bit<A, B, C> operator+(const bit<A, B, C>& lhs,
-                                const bit<A, B, C>& rhs);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator&=(
+    const bit& x) {
+  apply<detail::bitwise_op::bit_and>(x);
+  return *this;
+}
 
- private:
-  static constexpr value_type create_bit_pattern(size_t i) {
-    return ONE << (MSB_TO_LSB ? (T_BIT_SIZE - 1) - i : i);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator|=(
+    const bit& x) {
+  apply<detail::bitwise_op::bit_or>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator^=(
+    const bit& x) {
+  apply<detail::bitwise_op::bit_xor>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::andnot(
+    const bit& x) {
+  apply<detail::bitwise_op::bit_andnot>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator&=(
+    const view_type& x) {
+  apply<detail::bitwise_op::bit_and>(x.data(), x.offset(), x.size());
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator|=(
+    const view_type& x) {
+  apply<detail::bitwise_op::bit_or>(x.data(), x.offset(), x.size());
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator^=(
+    const view_type& x) {
+  apply<detail::bitwise_op::bit_xor>(x.data(), x.offset(), x.size());
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::andnot(
+    const view_type& x) {
+  apply<detail::bitwise_op::bit_andnot>(x.data(), x.offset(), x.size());
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::flip() noexcept {
+  invalidate_rank_index();
+  detail::bitwise<detail::bitwise_op::bit_not>(
+      reinterpret_cast<unsigned char*>(buffer_.data()), nullptr,
+      T_BYTE_SIZE * buffer_element_count());
+
+  // keep unused bits zero
+  clear_padding();
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::operator~() const {
+  bit result(*this);
+  result.flip();
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::count() const
+    noexcept {
+  return detail::popcount(
+      reinterpret_cast<const unsigned char*>(buffer_.data()),
+      T_BYTE_SIZE * buffer_element_count());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bool bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::any() const
+    noexcept {
+  return detail::any(reinterpret_cast<const unsigned char*>(buffer_.data()),
+                     T_BYTE_SIZE * buffer_element_count());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bool bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::none() const
+    noexcept {
+  return !any();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+bool bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::all() const
+    noexcept {
+  const size_type count = buffer_element_count();
+  if (count == 0) {
+    return true;
   }
 
-  template <size_t... i>
-  static constexpr auto create_bit_pattern_array(std::index_sequence<i...>) {
-    return std::array<value_type, sizeof...(i)>{{create_bit_pattern(i)...}};
+  // every full element, then the used bits of the last one
+  return detail::all(reinterpret_cast<const unsigned char*>(buffer_.data()),
+                     T_BYTE_SIZE * (count - 1)) &&
+         (buffer_[count - 1] == MASK_PATTERNS[next_bit_position_ - 1]);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_first() const
+    noexcept {
+  return find_from<true>(0);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_next(
+    size_type pos) const noexcept {
+  return pos == npos ? npos : find_from<true>(pos + 1);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_last() const
+    noexcept {
+  return find_last_of<true>();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+    TYPE_CHECK>::find_first_zero() const
+    noexcept {
+  return find_from<false>(0);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_next_zero(
+    size_type pos) const noexcept {
+  return pos == npos ? npos : find_from<false>(pos + 1);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+    TYPE_CHECK>::find_last_zero() const
+    noexcept {
+  return find_last_of<false>();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class FUNCTION>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::for_each_set_bit(FUNCTION f) const {
+  const size_type count = buffer_element_count();
+  for (size_type e = skip_elements<true>(0); e < count;
+       e = skip_elements<true>(e + 1)) {
+    value_type element = buffer_[e];
+    while (element != ZERO) {
+      const size_type i = first_in_element(element);
+      f(e * T_BIT_SIZE + i);
+      element &= static_cast<value_type>(~BIT_PATTERNS[i]);
+    }
   }
+}
 
-  static constexpr auto create_bit_pattern_array() {
-    return create_bit_pattern_array(std::make_index_sequence<T_BIT_SIZE>{});
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <bool FIND_ONE>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_from(
+    size_type pos) const noexcept {
+  const size_type n = bit_count();
+  if (pos >= n) {
+    return npos;
   }
 
-  static constexpr value_type create_mask_pattern(size_t i) {
-    value_type mask = ZERO;
-    for (size_t d = 0; d <= i; d++) mask |= create_bit_pattern(d);
-    return mask;
+  // drop the bits before pos in the first element
+  size_type e = pos / T_BIT_SIZE;
+  value_type element = FIND_ONE ? buffer_[e] : ~buffer_[e];
+  if (pos % T_BIT_SIZE != 0) {
+    element &= static_cast<value_type>(~MASK_PATTERNS[pos % T_BIT_SIZE - 1]);
   }
 
-  template <size_t... i>
-  static constexpr auto create_mask_pattern_array(std::index_sequence<i...>) {
-    return std::array<value_type, sizeof...(i)>{{create_mask_pattern(i)...}};
+  if (element == ZERO) {
+    e = skip_elements<FIND_ONE>(e + 1);
+    if (e >= buffer_element_count()) {
+      return npos;
+    }
+    element = FIND_ONE ? buffer_[e] : ~buffer_[e];
   }
 
-  static constexpr auto create_mask_pattern_array() {
-    return create_mask_pattern_array(std::make_index_sequence<T_BIT_SIZE>{});
+  // an inverted tail turns padding into ones
+  const size_type found = e * T_BIT_SIZE + first_in_element(element);
+  return found < n ? found : npos;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <bool FIND_ONE>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::find_last_of() const
+    noexcept {
+  size_type e = buffer_element_count();
+  while (e != 0) {
+    e--;
+    value_type element = FIND_ONE ? buffer_[e] : ~buffer_[e];
+    if (e == buffer_element_count() - 1) {
+      element &= MASK_PATTERNS[next_bit_position_ - 1];
+    }
+
+    if (element != ZERO) {
+      return e * T_BIT_SIZE + last_in_element(element);
+    }
   }
 
- private:
-  /**
-   * @brief BIT_PATTERNS are
-   *
-   * For MSB to LSB,
-   *    "10000000", "01000000", "00100000", "00010000",  "00001000", "00000100",
-   *    "00000010", "00000001"
-   *
-   * For LSB to MSB,
-   *    "00000001", "00000010", "00000100", "00001000",  "00010000", "00100000",
-   *    "01000000", "10000000"
-   */
-  static constexpr auto BIT_PATTERNS = create_bit_pattern_array();
+  return npos;
+}
 
-  /**
-   * @brief MASK_PATTERNS are
-   *
-   * For MSB to LSB,
-   *    "10000000", "11000000", "11100000", "11110000",  "11111000", "11111100",
-   *    "11111110", "11111111"
-   *
-   * For LSB to MSB,
-   *    "00000001", "00000011", "00000111", "00001111",  "00011111", "00111111",
-   *    "01111111", "11111111"
-   */
-  static constexpr auto MASK_PATTERNS = create_mask_pattern_array();
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <bool FIND_ONE>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::skip_elements(
+    size_type e) const noexcept {
+  const size_type count = buffer_element_count();
+  const value_type skip = FIND_ONE ? ZERO : VALUE_MAX;
 
-  // public:
-  //  class iterator;
-  //  class const_iterator;
-  //  class reverse_iterator;
-  //  class const_reverse_iterator;
+  // narrow elements are tested eight bytes at a time
+  if (T_BIT_SIZE < 64) {
+    const size_type step = 64 / T_BIT_SIZE;
+    const uint64_t chunk_skip = FIND_ONE ? 0 : ~uint64_t(0);
+    while (e + step <= count) {
+      uint64_t chunk;
+      std::memcpy(&chunk, buffer_.data() + e, 8);
+      if (chunk != chunk_skip) {
+        break;
+      }
+      e += step;
+    }
+  }
 
- public:
-  // constructor
-  bit();
+  while ((e < count) && (buffer_[e] == skip)) {
+    e++;
+  }
 
-  explicit bit(size_type n);
-  bit(size_type n, const value_type& val);
-  bit(const bit& x);
-  bit(bit&& x);
-  bit(std::initializer_list<value_type> il);
-  bit(const value_type* data, size_type size);
+  return e;
+}
 
-  // template <class InputIterator>
-  // bit(InputIterator first, InputIterator last);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::first_in_element(
+    value_type element) noexcept {
+  // element must not be zero
+  return MSB_TO_LSB ? detail::countl_zero(element) - (64 - T_BIT_SIZE)
+                    : detail::countr_zero(element);
+}
 
-  // destructor
-  ~bit();
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::last_in_element(
+    value_type element) noexcept {
+  // element must not be zero
+  return MSB_TO_LSB ? (T_BIT_SIZE - 1) - detail::countr_zero(element)
+                    : 63 - detail::countl_zero(element);
+}
 
-  // assignment operator
-  bit& operator=(const bit& x);
-  bit& operator=(bit&& x);
-  bit& operator=(std::initializer_list<value_type> il);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <detail::bitwise_op OP>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::apply(
+    const bit& x) {
+  if (x.bit_count() != bit_count()) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
 
-  // concatenate operator
-  // bit& operator+(const bit& x);
-  // bit& operator+(bit&& x);
+  invalidate_rank_index();
+  detail::bitwise<OP>(reinterpret_cast<unsigned char*>(buffer_.data()),
+                      reinterpret_cast<const unsigned char*>(x.buffer_.data()),
+                      T_BYTE_SIZE * buffer_element_count());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <detail::bitwise_op OP>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::apply(
+    const value_type* data, size_type pos, size_type n) {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  if (n != bit_count()) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
+
+  invalidate_rank_index();
+  const size_type whole = n / T_BIT_SIZE;
+  if (pos % T_BIT_SIZE == 0) {
+    detail::bitwise<OP>(
+        reinterpret_cast<unsigned char*>(buffer_.data()),
+        reinterpret_cast<const unsigned char*>(data + pos / T_BIT_SIZE),
+        T_BYTE_SIZE * whole);
+  } else {
+    for (size_type i = 0; i < whole; i++) {
+      buffer_[i] = static_cast<value_type>(detail::bitwise_word<OP>(
+          buffer_[i], range::extract(data, pos + i * T_BIT_SIZE, T_BIT_SIZE)));
+    }
+  }
+
+  // the last element of a view may run past its end
+  const size_type rest = n % T_BIT_SIZE;
+  if (rest != 0) {
+    const uint64_t field = range::extract(data, pos + n - rest, rest);
+    const uint64_t other =
+        MSB_TO_LSB ? field << (T_BIT_SIZE - rest) : field;
+    buffer_[whole] = static_cast<value_type>(
+        detail::bitwise_word<OP>(buffer_[whole], other));
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::clear_padding()
+    noexcept {
+  if (next_bit_position_ != T_BIT_SIZE) {
+    *last_byte_holder_ &= MASK_PATTERNS[next_bit_position_ - 1];
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::shift_towards_front(size_type n) noexcept {
+  typedef detail::bit_range<value_type, MSB_TO_LSB> range;
+
+  // bit i takes bit i + n, the last n bits become zero
+  const size_type size = bit_count();
+  n = std::min(n, size);
+  range::copy(buffer_.data(), 0, buffer_.data(), n, size - n);
+  range::fill(buffer_.data(), size - n, n, false);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::shift_towards_back(size_type n) noexcept {
+  typedef detail::bit_range<value_type, MSB_TO_LSB> range;
+
+  // bit i + n takes bit i, the first n bits become zero
+  const size_type size = bit_count();
+  n = std::min(n, size);
+  range::copy_backward(buffer_.data(), n, buffer_.data(), 0, size - n);
+  range::fill(buffer_.data(), 0, n, false);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::build_rank_index() const {
+  build_rank_index([](size_type n, auto f) { f(size_type(0), n); });
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+template <class PARALLEL_FOR>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::build_rank_index(PARALLEL_FOR parallel_for) const {
+  rank_index& index = allocate_rank_index();
+  if (index.valid) {
+    return;
+  }
+
+  const size_type n = bit_count();
+  const size_type block_count =
+      (n + RANK_BLOCK_BIT_SIZE - 1) / RANK_BLOCK_BIT_SIZE;
+  const size_type superblock_count =
+      (n + RANK_SUPERBLOCK_BIT_SIZE - 1) / RANK_SUPERBLOCK_BIT_SIZE;
+  const size_type byte_count =
+      T_BYTE_SIZE * ((n + T_BIT_SIZE - 1) / T_BIT_SIZE);
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(buffer_.data());
+
+  index.superblocks.assign(superblock_count + 1, 0);
+  index.blocks.assign(block_count, 0);
+
+  // superblocks are counted on their own, superblocks[sb + 1] takes the
+  // ones of superblock sb until the prefix sum below. Blocks are whole
+  // bytes, so the counts do not depend on the bit order.
+  parallel_for(superblock_count, [&](size_type begin, size_type end) {
+    for (size_type sb = begin; sb < end; sb++) {
+      const size_type last =
+          std::min(block_count, (sb + 1) * RANK_BLOCKS_PER_SUPERBLOCK);
+      uint16_t local = 0;
+      for (size_type b = sb * RANK_BLOCKS_PER_SUPERBLOCK; b < last; b++) {
+        const size_type first = b * (RANK_BLOCK_BIT_SIZE / 8);
+        const size_type length =
+            std::min(RANK_BLOCK_BIT_SIZE / 8, byte_count - first);
+        index.blocks[b] = local;
+        local = static_cast<uint16_t>(
+            local + detail::popcount(bytes + first, length));
+      }
+      index.superblocks[sb + 1] = local;
+    }
+  });
+
+  for (size_type sb = 0; sb < superblock_count; sb++) {
+    index.superblocks[sb + 1] += index.superblocks[sb];
+  }
+
+  // sample superblocks for select
+  index.ones_samples.clear();
+  index.zeros_samples.clear();
+  for (size_type sb = 0; sb < superblock_count; sb++) {
+    while (index.ones_samples.size() * SELECT_SAMPLE_RATE <
+           index.superblocks[sb + 1]) {
+      index.ones_samples.push_back(sb);
+    }
+
+    while (index.zeros_samples.size() * SELECT_SAMPLE_RATE <
+           rank_zeros_before(sb + 1)) {
+      index.zeros_samples.push_back(sb);
+    }
+  }
+
+  index.valid = true;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rank1(
+    size_type n) const {
+  if (n > bit_count()) {
+    throw std::out_of_range("rank position is out of range.");
+  }
+
+  build_rank_index();
+
+  if (n == bit_count()) {
+    return rank_index_->superblocks.back();
+  }
+
+  const size_type block = n / RANK_BLOCK_BIT_SIZE;
+  size_type count = rank_index_->superblocks[n / RANK_SUPERBLOCK_BIT_SIZE] +
+                    rank_index_->blocks[block];
+
+  // whole elements between the block start and n
+  const size_type first = block * (RANK_BLOCK_BIT_SIZE / T_BIT_SIZE);
+  const size_type last = n / T_BIT_SIZE;
+  count += detail::popcount(
+      reinterpret_cast<const unsigned char*>(buffer_.data() + first),
+      (last - first) * T_BYTE_SIZE);
+
+  if (n % T_BIT_SIZE != 0) {
+    count += detail::popcount(
+        uint64_t(buffer_[last] & MASK_PATTERNS[n % T_BIT_SIZE - 1]));
+  }
+
+  return count;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rank0(
+    size_type n) const {
+  return n - rank1(n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::select1(
+    size_type k) const {
+  build_rank_index();
+
+  const auto& superblocks = rank_index_->superblocks;
+  if (k >= superblocks.back()) {
+    throw std::out_of_range("select rank is out of range.");
+  }
+
+  // the samples bound the superblock search
+  const auto& samples = rank_index_->ones_samples;
+  const size_type sample = k / SELECT_SAMPLE_RATE;
+  const size_type low = samples[sample];
+  const size_type high = sample + 1 < samples.size() ? samples[sample + 1] + 1
+                                                     : superblocks.size() - 1;
+  const size_type sb =
+      std::upper_bound(superblocks.begin() + low + 1,
+                       superblocks.begin() + high + 1, k) -
+      superblocks.begin() - 1;
+  k -= superblocks[sb];
+
+  size_type block = sb * RANK_BLOCKS_PER_SUPERBLOCK;
+  const size_type block_end = std::min(block + RANK_BLOCKS_PER_SUPERBLOCK,
+                                       rank_index_->blocks.size());
+  while ((block + 1 < block_end) && (rank_index_->blocks[block + 1] <= k)) {
+    block++;
+  }
+  k -= rank_index_->blocks[block];
+
+  size_type e = block * (RANK_BLOCK_BIT_SIZE / T_BIT_SIZE);
+  while (true) {
+    const size_type count = detail::popcount(uint64_t(buffer_[e]));
+    if (k < count) {
+      return e * T_BIT_SIZE + select_in_element(buffer_[e], k);
+    }
+
+    k -= count;
+    e++;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::select0(
+    size_type k) const {
+  build_rank_index();
+
+  const size_type superblock_count = rank_index_->superblocks.size() - 1;
+  if (k >= rank_zeros_before(superblock_count)) {
+    throw std::out_of_range("select rank is out of range.");
+  }
+
+  const auto& samples = rank_index_->zeros_samples;
+  const size_type sample = k / SELECT_SAMPLE_RATE;
+  size_type low = samples[sample];
+  size_type high = sample + 1 < samples.size() ? samples[sample + 1]
+                                               : superblock_count - 1;
+  while (low < high) {
+    const size_type mid = low + (high - low + 1) / 2;
+    if (rank_zeros_before(mid) <= k) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  k -= rank_zeros_before(low);
+
+  size_type block = low * RANK_BLOCKS_PER_SUPERBLOCK;
+  const size_type block_end = std::min(block + RANK_BLOCKS_PER_SUPERBLOCK,
+                                       rank_index_->blocks.size());
+  const size_type first_block = block;
+  while ((block + 1 < block_end) &&
+         ((block + 1 - first_block) * RANK_BLOCK_BIT_SIZE -
+              rank_index_->blocks[block + 1] <=
+          k)) {
+    block++;
+  }
+  k -= (block - first_block) * RANK_BLOCK_BIT_SIZE - rank_index_->blocks[block];
+
+  // padding past the last bit comes after every real zero
+  size_type e = block * (RANK_BLOCK_BIT_SIZE / T_BIT_SIZE);
+  while (true) {
+    const value_type element = static_cast<value_type>(~buffer_[e]);
+    const size_type count = detail::popcount(uint64_t(element));
+    if (k < count) {
+      return e * T_BIT_SIZE + select_in_element(element, k);
+    }
+
+    k -= count;
+    e++;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::invalidate_rank_index() noexcept {
+  if (rank_index_ != nullptr) {
+    rank_index_->valid = false;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rank_index&
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+    TYPE_CHECK>::allocate_rank_index() const {
+  if (rank_index_ == nullptr) {
+    rank_index_allocator allocator(buffer_.get_allocator());
+    rank_index* index = rank_index_traits::allocate(allocator, 1);
+    try {
+      rank_index_traits::construct(allocator, index, buffer_.get_allocator());
+    } catch (...) {
+      rank_index_traits::deallocate(allocator, index, 1);
+      throw;
+    }
+    rank_index_ = index;
+  }
+  return *rank_index_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR,
+         TYPE_CHECK>::release_rank_index() noexcept {
+  if (rank_index_ != nullptr) {
+    rank_index_allocator allocator(buffer_.get_allocator());
+    rank_index_traits::destroy(allocator, rank_index_);
+    rank_index_traits::deallocate(allocator, rank_index_, 1);
+    rank_index_ = nullptr;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::rank_zeros_before(
+    size_type superblock) const noexcept {
+  return std::min(superblock * RANK_SUPERBLOCK_BIT_SIZE, bit_count()) -
+         rank_index_->superblocks[superblock];
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::size_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::select_in_element(
+    value_type element, size_type k) const noexcept {
+  // smallest i such that the first i + 1 bits hold k + 1 ones
+  size_type low = 0;
+  size_type high = T_BIT_SIZE - 1;
+  while (low < high) {
+    const size_type mid = (low + high) / 2;
+    if (detail::popcount(uint64_t(element & MASK_PATTERNS[mid])) > k) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * @brief Non-owning, read only view of a bit range.
+ *
+ * A view is an element pointer, a bit offset into the first element and a
+ * length, so slicing never copies. It reads the range with the same bit
+ * order as bit and never looks at the bits around it.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class bit_view {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef BUFFER_ELEMENT_TYPE const_reference;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef bit_iterator<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, true> const_iterator;
+  typedef const_iterator iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_type npos = size_type(-1);
+
+ public:
+  // constructor
+  bit_view() noexcept = default;
+  template <class ALLOCATOR>
+  bit_view(const bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR>& x) noexcept;
+  bit_view(const value_type* data, size_type offset, size_type size) noexcept;
 
   // iterator
-  // iterator begin();
-  // iterator end();
-  // const_iterator cbegin() const;
-  // const_iterator cend() const;
-  // reverse_iterator rbegin();
-  // reverse_iterator rend();
-  // const_reverse_iterator crbegin() const;
-  // const_reverse_iterator crend() const;
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept;
+  const_iterator cbegin() const noexcept;
+  const_iterator cend() const noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+  const_reverse_iterator rend() const noexcept;
 
   // capacity
-  size_type size() const noexcept;
-  void resize(size_type n);
-  void resize(size_type n, const value_type& val);
-  void reserve(size_type n);
-  size_type buffer_element_count() const noexcept;
-  size_type buffer_element_size() const noexcept;
+  size_type size() const noexcept;
   bool empty() const noexcept;
 
   // element access
-  value_type operator[](size_type n) const;
+  value_type operator[](size_type n) const noexcept;
   value_type at(size_type n) const;
   value_type front() const noexcept;
   value_type back() const noexcept;
   const value_type* data() const noexcept;
-  value_type* data() noexcept;
-  // bit sub_range(size_type begin, size_type end) const;
-
-  // modifiers
-  void push(value_type value);
-  void pop();
-  void replace(size_type position, value_type value);
-  void align(value_type value = ZERO);
-  void push_byte(unsigned char value);
-  void push_bytes(const unsigned char* data, size_type n);
-
-  // template <class InputIterator>
-  // void push_bytes(InputIterator first, InputIterator last);
+  size_type offset() const noexcept;
+  bit_view sub_range(size_type begin, size_type end) const;
 
-  void clear() noexcept;
+  // read a field in the bit::push_bits() layout, n is 0 to 64
+  uint64_t bits(size_type position, unsigned n) const;
 
- private:
-  inline void push_with_resize(value_type value);
-  inline void pop_with_resize();
-  inline value_type bit_value_at(size_type position) const;
-  inline value_type bit_value(size_type position) const;
-  inline size_type bit_count() const noexcept;
-  inline size_type bit_remainder() noexcept;
-  inline void initialize_from(const std::initializer_list<value_type>& type);
+  // counting and search
+  size_type count() const noexcept;
+  bool any() const noexcept;
+  bool none() const noexcept;
+  bool all() const noexcept;
+  size_type find_first() const noexcept;
+  size_type find_first_zero() const noexcept;
 
  private:
-  container_type buffer_;
-  value_type* last_byte_holder_ = nullptr;
-  size_type next_bit_position_ = 0;
+  const value_type* data_ = nullptr;
+  size_type offset_ = 0;
+  size_type size_ = 0;
 };
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator+(
-    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
-    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
-  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> concat;
+template <class ALLOCATOR>
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_view(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>& x) noexcept
+    : bit_view(x.data(), 0, x.size()) {}
 
-  if (lhs.next_bit_position_ ==
-      bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::T_BIT_SIZE) {
-    concat.buffer_.resize(lhs.buffer_.size());
-    concat.last_byte_holder_ = &(concat.buffer_.back());
-  } else {
-    for (typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type i =
-             0;
-         i < lhs.size(); i++) {
-      concat.push(lhs[i]);
-    }
-  }
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_view(
+    const value_type* data, size_type offset, size_type size) noexcept
+    : data_(data == nullptr ? data : data + offset / T_BIT_SIZE),
+      offset_(offset % T_BIT_SIZE),
+      size_(size) {}
 
-  if (rhs.next_bit_position_ ==
-      bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::T_BIT_SIZE) {
-    concat.buffer_.resize(rhs.buffer_.size() + concat.buffer_.size());
-    concat.last_byte_holder_ = &(concat.buffer_.back());
-  } else {
-    for (typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type i =
-             0;
-         i < rhs.size(); i++) {
-      concat.push(rhs[i]);
-    }
-  }
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::const_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::begin() const noexcept {
+  return const_iterator(data_, offset_);
+}
 
-  return concat;
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::const_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::end() const noexcept {
+  return const_iterator(data_, offset_ + size_);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit() {
-  clear();
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::const_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::cbegin() const noexcept {
+  return begin();
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(size_type n) {
-  resize(n);
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::const_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::cend() const noexcept {
+  return end();
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(size_type n,
-                                                     const value_type& val) {
-  resize(n, val);
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                  TYPE_CHECK>::const_reverse_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::rbegin() const noexcept {
+  return const_reverse_iterator(end());
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(const bit& x) {
-  *this = x;
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                  TYPE_CHECK>::const_reverse_iterator
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::rend() const noexcept {
+  return const_reverse_iterator(begin());
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(bit&& x) {
-  *this = x;
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() const noexcept {
+  return size_;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(
-    std::initializer_list<value_type> il) {
-  initialize_from(il);
+bool bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::empty() const
+    noexcept {
+  return size_ == 0;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit(const value_type* data,
-                                                     size_type size) {
-  resize(size);
-  std::memcpy(buffer_.data(), data,
-              T_BYTE_SIZE * (size + T_BIT_SIZE - 1) / T_BIT_SIZE);
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+    bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator[](
+        size_type n) const noexcept {
+  return begin()[static_cast<difference_type>(n)];
+}
 
-  // clean up tail if necessary
-  if (next_bit_position_ != T_BIT_SIZE) {
-    *last_byte_holder_ = MASK_PATTERNS[next_bit_position_ - 1];
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::at(size_type n) const {
+  if (n >= size_) {
+    throw std::out_of_range("bit access is out of range.");
   }
+
+  return (*this)[n];
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::~bit() {}
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::front() const noexcept {
+  return (*this)[0];
+}
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator=(const bit& x) {
-  buffer_ = x.buffer_;
-  last_byte_holder_ = &(buffer_.back());
-  next_bit_position_ = x.next_bit_position_;
-  return *this;
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::back() const noexcept {
+  return (*this)[size_ - 1];
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator=(bit&& x) {
-  buffer_ = std::move(x.buffer_);
-  last_byte_holder_ = x.last_byte_holder_;
-  next_bit_position_ = x.next_bit_position_;
-  return *this;
+const typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type*
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() const noexcept {
+  return data_;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator=(
-    std::initializer_list<value_type> il) {
-  initialize_from(il);
-  return *this;
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::offset() const noexcept {
+  return offset_;
 }
 
-// template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-// bit& bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator+(bit&& x) {}
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::sub_range(
+    size_type begin, size_type end) const {
+  if ((begin > end) || (end > size_)) {
+    throw std::out_of_range("bit range is out of range.");
+  }
+
+  return bit_view(data_, offset_ + begin, end - begin);
+}
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push_with_resize(
-    value_type value) {
-  if ((value != ZERO) && (value != ONE)) {
-    throw std::invalid_argument("input argument is not one or zero.");
+uint64_t bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bits(
+    size_type position, unsigned n) const {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  if (n > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
   }
 
-  if (next_bit_position_ == T_BIT_SIZE) {
-    buffer_.resize(buffer_.size() + 1);
-    last_byte_holder_ = &(buffer_.back());
-    *(last_byte_holder_) = ZERO;
-    next_bit_position_ = 0;
+  if ((position > size_) || (n > size_ - position)) {
+    throw std::out_of_range("bit read is out of range.");
   }
 
-  if (value == ONE) {
-    *(last_byte_holder_) =
-        *(last_byte_holder_) | BIT_PATTERNS[next_bit_position_];
+  // gather the field an element (at most) at a time
+  uint64_t value = 0;
+  size_type done = 0;
+  while (done < n) {
+    const size_type k = std::min<size_type>(n - done, T_BIT_SIZE);
+    const uint64_t field =
+        range::extract(data_, offset_ + position + done, k);
+    if (MSB_TO_LSB) {
+      value = k == 64 ? field : (value << k) | field;
+    } else {
+      value |= field << done;
+    }
+    done += k;
   }
 
-  next_bit_position_++;
+  return value;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::pop_with_resize() {
-  if (next_bit_position_ == 0) {
-    if (buffer_.size() > 1) {
-      buffer_.pop_back();
-      last_byte_holder_ = &(buffer_.back());
-      next_bit_position_ = T_BIT_SIZE;
-    }
-  }
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::count() const noexcept {
+  return detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::count(
+      data_, offset_, size_);
+}
 
-  next_bit_position_--;
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::any() const
+    noexcept {
+  return find_first() != npos;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::clear() noexcept {
-  buffer_.clear();
-  next_bit_position_ = T_BIT_SIZE;
+bool bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::none() const
+    noexcept {
+  return !any();
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_value_at(
-    size_type position) const {
-  if (position >= (buffer_.size() - 1) * T_BIT_SIZE + next_bit_position_) {
-    throw std::out_of_range("bit query position is out of range.");
-  }
+bool bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::all() const
+    noexcept {
+  return find_first_zero() == npos;
+}
 
-  return bit_value(position);
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_first() const
+    noexcept {
+  const size_type n = detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::find(
+      data_, offset_, size_, true);
+  return n == size_ ? npos : n;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_value(
-    size_type position) const {
-  size_type byte_position = position / T_BIT_SIZE;
-  size_type bit_position = position % T_BIT_SIZE;
-  value_type byte = buffer_.operator[](byte_position);
-  return (byte & BIT_PATTERNS[bit_position]) == ZERO ? ZERO : ONE;
-  // return (byte >>
-  //         (MSB_TO_LSB ? ((T_BIT_SIZE - 1) - bit_position) : bit_position)) &
-  //        ONE;
+typename bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_first_zero() const
+    noexcept {
+  const size_type n = detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::find(
+      data_, offset_, size_, false);
+  return n == size_ ? npos : n;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_count() const noexcept {
-  return (buffer_.size() - 1) * T_BIT_SIZE + next_bit_position_;
+bool operator==(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  return (lhs.size() == rhs.size()) &&
+         detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB>::equal(
+             lhs.data(), lhs.offset(), rhs.data(), rhs.offset(), lhs.size());
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_remainder() noexcept {
-  return T_BIT_SIZE - next_bit_position_;
+bool operator!=(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  return !(lhs == rhs);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::initialize_from(
-    const std::initializer_list<value_type>& il) {
-  resize(il.size());
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> operator&(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> result(lhs.begin(), lhs.end());
+  result &= rhs;
+  return result;
+}
 
-  size_type i = 0;
-  for (auto& value : il) {
-    std::cout << value << std::endl;
-    if ((value != ZERO) && (value != ONE)) {
-      throw std::invalid_argument("input argument is not one or zero.");
-    }
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> operator|(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> result(lhs.begin(), lhs.end());
+  result |= rhs;
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> operator^(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& lhs,
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB> result(lhs.begin(), lhs.end());
+  result ^= rhs;
+  return result;
+}
 
-    replace(i, value);
-    i++;
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR,
+          class TYPE_CHECK>
+typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::view_type
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR, TYPE_CHECK>::sub_range(
+    size_type begin, size_type end) const {
+  if ((begin > end) || (end > bit_count())) {
+    throw std::out_of_range("bit range is out of range.");
   }
+
+  return view_type(buffer_.data(), begin, end - begin);
 }
 
+template <class BUFFER_ELEMENT_TYPE, bool MSB_TO_LSB>
+class prefix_decoder;
+
+/**
+ * @brief Sequential reader over a bit buffer.
+ *
+ * Elements are loaded into a 64-bit cache window so that fields of up to 64
+ * bits come out with a couple of shifts. read_bits() returns the field in the
+ * same layout push_bits() takes it, so a field written with push_bits(v, n)
+ * reads back as v.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class bit_reader {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef size_t size_type;
+
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_t CACHE_BIT_SIZE = 64;
+
+ public:
+  // constructor
+  template <class ALLOCATOR>
+  explicit bit_reader(
+      const bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR>& x);
+  explicit bit_reader(const bit_view<BUFFER_ELEMENT_TYPE, MSB_TO_LSB>& x);
+  bit_reader(const value_type* data, size_type size);
+
+  // read
+  uint64_t read_bits(unsigned n);
+  uint64_t peek_bits(unsigned n);
+  value_type read_bit();
+  void skip_bits(size_type n);
+  void byte_align();
+
+  /**
+   * @brief Exp-Golomb codes as written by bit::push_ue()/push_se(). The
+   * batch variants decode every code that fits the cache window straight
+   * from it and refill once per window.
+   */
+  uint64_t read_ue();
+  int64_t read_se();
+  void read_ue(uint64_t* values, size_type n);
+  void read_se(int64_t* values, size_type n);
+
+  // position
+  size_type bits_left() const noexcept;
+  size_type position() const noexcept;
+
+ private:
+  inline void refill() noexcept;
+  inline void drop(size_type n) noexcept;
+  inline uint64_t take(size_type n) noexcept;
+  inline uint64_t cached(size_type n) const noexcept;
+  inline uint64_t element(size_type index) const noexcept;
+  inline size_type read_ue_cached(uint64_t* values, size_type n) noexcept;
+
+ private:
+  // decodes codes straight from the cache
+  template <class, bool>
+  friend class prefix_decoder;
+
+ private:
+  const value_type* data_ = nullptr;
+  size_type size_ = 0;
+  size_type element_count_ = 0;
+  size_type next_element_ = 0;
+  uint64_t cache_ = 0;
+  size_type cache_bits_ = 0;
+  // bits before the first one read, for a view that starts mid-element
+  size_type origin_ = 0;
+};
+
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() const noexcept {
-  return bit_count();
-}
+template <class ALLOCATOR>
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_reader(
+    const bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>& x)
+    : bit_reader(x.data(), x.size()) {}
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::reserve(size_type n) {
-  buffer_.reserve((n + T_BIT_SIZE - 1) / T_BIT_SIZE);
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_reader(
+    const bit_view<BIT_CONTAINER_TYPE, MSB_TO_LSB>& x)
+    : bit_reader(x.data(), x.offset() + x.size()) {
+  skip_bits(x.offset());
+  origin_ = x.offset();
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::resize(size_type n) {
-  buffer_.resize((n + T_BIT_SIZE - 1) / T_BIT_SIZE);
-  last_byte_holder_ = &(buffer_.back());
-  next_bit_position_ = (n % T_BIT_SIZE) == 0 ? T_BIT_SIZE : (n % T_BIT_SIZE);
-}
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bit_reader(
+    const value_type* data, size_type size)
+    : data_(data),
+      size_(size),
+      element_count_((size + T_BIT_SIZE - 1) / T_BIT_SIZE) {}
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::resize(
-    size_type n, const value_type& value) {
-  if ((value != ZERO) && (value != ONE)) {
-    throw std::invalid_argument("input argument is not one or zero.");
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_bits(
+    unsigned n) {
+  if (n > CACHE_BIT_SIZE) {
+    throw std::invalid_argument("bit count is larger than 64.");
   }
 
-  const value_type element_value = value == ONE ? VALUE_MAX : ZERO;
-  buffer_.resize((n + T_BIT_SIZE - 1) / T_BIT_SIZE, element_value);
-  last_byte_holder_ = &(buffer_.back());
-  next_bit_position_ = (n % T_BIT_SIZE) == 0 ? T_BIT_SIZE : (n % T_BIT_SIZE);
+  if (n > bits_left()) {
+    throw std::out_of_range("bit read is out of range.");
+  }
 
-  // keep unused bits zero
-  *last_byte_holder_ = MASK_PATTERNS[next_bit_position_ - 1];
+  if (n == 0) {
+    return 0;
+  }
+
+  if (cache_bits_ < n) {
+    refill();
+  }
+
+  if (cache_bits_ >= n) {
+    return take(n);
+  }
+
+  // field straddles the cache and the next element
+  const size_type head = cache_bits_;
+  const uint64_t high = take(head);
+  refill();
+  const uint64_t low = take(n - head);
+  return MSB_TO_LSB ? (high << (n - head)) | low : high | (low << head);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::buffer_element_count() const
-    noexcept {
-  return buffer_.size();
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::peek_bits(
+    unsigned n) {
+  if (n > CACHE_BIT_SIZE) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  if (n > bits_left()) {
+    throw std::out_of_range("bit read is out of range.");
+  }
+
+  if (n == 0) {
+    return 0;
+  }
+
+  if (cache_bits_ < n) {
+    refill();
+  }
+
+  if (cache_bits_ >= n) {
+    return cached(n);
+  }
+
+  // the cache holds more than 64 - T_BIT_SIZE bits after refill, so the rest
+  // always comes from the single next element
+  const size_type head = cache_bits_;
+  const size_type rest = n - head;
+  const uint64_t word = element(next_element_);
+  const uint64_t high = cached(head);
+  const uint64_t low = MSB_TO_LSB ? word >> (T_BIT_SIZE - rest)
+                                  : word & ((uint64_t(1) << rest) - 1);
+  return MSB_TO_LSB ? (high << rest) | low : high | (low << head);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::buffer_element_size() const
-    noexcept {
-  return T_BYTE_SIZE;
+typename bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_bit() {
+  return static_cast<value_type>(read_bits(1));
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-bool bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::empty() const noexcept {
-  return bit_count() == 0;
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::skip_bits(
+    size_type n) {
+  if (n > bits_left()) {
+    throw std::out_of_range("bit skip is out of range.");
+  }
+
+  if (n <= cache_bits_) {
+    drop(n);
+    return;
+  }
+
+  // jump over whole elements without loading them
+  n -= cache_bits_;
+  cache_ = 0;
+  cache_bits_ = 0;
+  next_element_ += n / T_BIT_SIZE;
+  refill();
+  drop(n % T_BIT_SIZE);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-    bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator[](
-        size_type n) const {
-  return bit_value(n);
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::byte_align() {
+  skip_bits((8 - position() % 8) % 8);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::at(size_type n) const {
-  return bit_value_at(n);
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_ue() {
+  // count the zero run a cache at a time
+  size_type zeros = 0;
+  refill();
+  while (cache_ == 0) {
+    if (cache_bits_ == 0) {
+      throw std::out_of_range("exp-golomb code is out of range.");
+    }
+
+    zeros += cache_bits_;
+    drop(cache_bits_);
+    refill();
+  }
+
+  const size_type lead =
+      MSB_TO_LSB ? detail::countl_zero(cache_) : detail::countr_zero(cache_);
+  const size_type len = zeros + lead;
+  if ((len > 63) || (len + 1 > bits_left() - lead)) {
+    throw std::out_of_range("exp-golomb code is out of range.");
+  }
+
+  drop(lead + 1);
+
+  uint64_t info = 0;
+  if (len != 0) {
+    info = len <= cache_bits_ ? take(len)
+                              : read_bits(static_cast<unsigned>(len));
+  }
+
+  return (uint64_t(1) << len) - 1 + info;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::front() const noexcept {
-  return (MSB_TO_LSB ? buffer_[0] >> (T_BIT_SIZE - 1) : buffer_[0]) & ONE;
+int64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_se() {
+  const uint64_t code = read_ue();
+  return (code & 1) != 0 ? static_cast<int64_t>((code >> 1) + 1)
+                         : -static_cast<int64_t>(code >> 1);
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::back() const noexcept {
-  return bit_value(bit_count() - 1);
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_ue(
+    uint64_t* values, size_type n) {
+  size_type i = 0;
+  while (i < n) {
+    refill();
+    const size_type decoded = read_ue_cached(values + i, n - i);
+    i += decoded;
+
+    // a code longer than a full window takes the single code path
+    if ((decoded == 0) && (i < n)) {
+      values[i++] = read_ue();
+    }
+  }
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-const typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type*
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() const noexcept {
-  return buffer_.data();
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_se(
+    int64_t* values, size_type n) {
+  uint64_t* codes = reinterpret_cast<uint64_t*>(values);
+  read_ue(codes, n);
+  for (size_type i = 0; i < n; i++) {
+    const uint64_t code = codes[i];
+    values[i] = (code & 1) != 0 ? static_cast<int64_t>((code >> 1) + 1)
+                                : -static_cast<int64_t>(code >> 1);
+  }
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-typename bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type*
-bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() noexcept {
-  return buffer_.data();
+typename bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::bits_left() const
+    noexcept {
+  return size_ - origin_ - position();
 }
+
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push(value_type value) {
-  push_with_resize(value);
+typename bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::position() const
+    noexcept {
+  return next_element_ * T_BIT_SIZE - cache_bits_ - origin_;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::pop() {
-  pop_with_resize();
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::refill() noexcept {
+  while ((cache_bits_ + T_BIT_SIZE <= CACHE_BIT_SIZE) &&
+         (next_element_ < element_count_)) {
+    const uint64_t word = element(next_element_++);
+    cache_ |= MSB_TO_LSB ? word << (CACHE_BIT_SIZE - T_BIT_SIZE - cache_bits_)
+                         : word << cache_bits_;
+    cache_bits_ += T_BIT_SIZE;
+  }
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::replace(
-    size_type position, value_type value) {
-  size_type byte_position = position / T_BIT_SIZE;
-  size_type bit_position = position % T_BIT_SIZE;
-
-  if (value == ONE) {
-    buffer_.at(byte_position) |= BIT_PATTERNS[bit_position];
+void bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::drop(
+    size_type n) noexcept {
+  if (n == CACHE_BIT_SIZE) {
+    cache_ = 0;
+  } else {
+    cache_ = MSB_TO_LSB ? cache_ << n : cache_ >> n;
   }
 
-  if (value == ZERO) {
-    buffer_.at(byte_position) &= ~BIT_PATTERNS[bit_position];
-  }
+  cache_bits_ -= n;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::align(value_type value) {
-  int b = 0;
-  while (next_bit_position_ != T_BIT_SIZE) {
-    push((value & BIT_PATTERNS[b]) == ZERO ? ZERO : ONE);
-    b++;
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::take(
+    size_type n) noexcept {
+  const uint64_t value = cached(n);
+  drop(n);
+  return value;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::cached(
+    size_type n) const noexcept {
+  // n is 1 to 64, the next bit is the MSB (or the LSB) of the cache
+  if (MSB_TO_LSB) {
+    return cache_ >> (CACHE_BIT_SIZE - n);
   }
+
+  return n == CACHE_BIT_SIZE ? cache_ : cache_ & ((uint64_t(1) << n) - 1);
 }
 
+// decodes the codes lying wholly in the cache, returns how many
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push_byte(
-    unsigned char value) {
-  if (std::is_same<BIT_CONTAINER_TYPE, unsigned char>::value &&
-      (next_bit_position_ == T_BIT_SIZE)) {
-    buffer_.resize(buffer_.size() + 1);
-    last_byte_holder_ = &(buffer_.back());
-    *(last_byte_holder_) = value;
-  } else {
-    for (size_type i = 0; i < 8; i++) {
-      push(((value & (0x80 >> i)) == 0u) ? ZERO : ONE);
+typename bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::read_ue_cached(
+    uint64_t* values, size_type n) noexcept {
+  // locals, since stores to values may alias the members
+  uint64_t cache = cache_;
+  size_type bits = cache_bits_;
+  size_type i = 0;
+
+  // bits past cache_bits_ are zero, so a nonzero cache holds the next one
+  while ((i < n) && (cache != 0)) {
+    const size_type lead =
+        MSB_TO_LSB ? detail::countl_zero(cache) : detail::countr_zero(cache);
+    const size_type length = 2 * lead + 1;
+    if (length > bits) {
+      break;
+    }
+
+    // length is odd, so less than 64
+    if (MSB_TO_LSB) {
+      values[i++] = (cache >> (CACHE_BIT_SIZE - length)) - 1;
+      cache <<= length;
+    } else {
+      const uint64_t info =
+          (cache >> (lead + 1)) & ((uint64_t(1) << lead) - 1);
+      values[i++] = (uint64_t(1) << lead) - 1 + info;
+      cache >>= length;
     }
+    bits -= length;
   }
+
+  cache_ = cache;
+  cache_bits_ = bits;
+  return i;
 }
 
 template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
-void bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push_bytes(
-    const unsigned char* data, size_type n) {
-  if (std::is_same<BIT_CONTAINER_TYPE, unsigned char>::value &&
-      (next_bit_position_ == T_BIT_SIZE)) {
-    buffer_.resize(buffer_.size() + n);
-    last_byte_holder_ = &(buffer_.back());
-    std::memcpy(buffer_.data() + buffer_.size() - n, data, n);
-  } else {
-    for (size_type j = 0; j < n; j++) {
-      for (size_type i = 0; i < 8; i++) {
-        push(((data[j] & BIT_PATTERNS[i]) == 0u) ? ZERO : ONE);
-      }
-    }
+uint64_t bit_reader<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::element(
+    size_type index) const noexcept {
+  uint64_t word = data_[index];
+
+  // a raw buffer may carry garbage past the last bit
+  const size_type tail = size_ % T_BIT_SIZE;
+  if ((index == element_count_ - 1) && (tail != 0)) {
+    const uint64_t mask = (uint64_t(1) << tail) - 1;
+    word &= MSB_TO_LSB ? mask << (T_BIT_SIZE - tail) : mask;
   }
+
+  return word;
+}
+
+namespace detail {
+// field of n bits as push_bits() takes it, from bits with bit k first
+template <bool MSB_TO_LSB>
+inline uint64_t to_field(uint64_t bits, size_t n) noexcept {
+  return MSB_TO_LSB ? reverse_bits(bits) >> (64 - n) : bits;
 }
 
+template <bool MSB_TO_LSB>
+inline uint64_t from_field(uint64_t field, size_t n) noexcept {
+  return MSB_TO_LSB ? reverse_bits(field << (64 - n)) : field;
+}
+
+// bit_view of anything with sub_range(), a bit or a bit_view
+template <class BITS>
+using view_of = decltype(std::declval<const BITS&>().sub_range(0, 0));
+
+template <class VIEW>
+struct view_order;
+
+template <class T, bool MSB_TO_LSB, class TYPE_CHECK>
+struct view_order<bit_view<T, MSB_TO_LSB, TYPE_CHECK>>
+    : std::integral_constant<bool, MSB_TO_LSB> {};
+}  // namespace detail
 }  // namespace jcy
 
 #endif  // BIT_HPP_
@@ -0,0 +1,365 @@
+/**
+ * @file bit_convert.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BIT_CONVERT_HPP_
+#define BIT_CONVERT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+// how one bit is spelled as a byte
+enum class byte_code {
+  zero_one,   // 0x00 or 0x01, as bool
+  character,  // '0' or '1'
+  high_bit    // a one has the top bit set, as a SIMD compare result
+};
+
+template <byte_code CODE>
+constexpr unsigned char byte_code_zero() noexcept {
+  return CODE == byte_code::character ? '0' : 0;
+}
+
+// up to 8 bytes, byte k to bit k, false for a byte that is not a code
+template <byte_code CODE>
+inline bool pack_bytes_scalar(const unsigned char* src, size_t n,
+                              uint64_t& bits) noexcept {
+  const uint64_t ones = 0x0101010101010101ull;
+  unsigned char bytes[8] = {};
+  std::memcpy(bytes, src, n);
+  uint64_t word = load_element<uint64_t, false>(bytes);
+
+  if (CODE == byte_code::high_bit) {
+    word = (word >> 7) & ones;
+  } else {
+    // the zero bytes past n stay zero
+    const uint64_t used = n == 8 ? ~uint64_t(0) : (uint64_t(1) << 8 * n) - 1;
+    word ^= (ones * byte_code_zero<CODE>()) & used;
+    if ((word & ~ones) != 0) {
+      return false;
+    }
+  }
+
+  // every byte lands on its own bit of the top byte, without carries
+  bits = (word * 0x0102040810204080ull) >> 56;
+  return true;
+}
+
+#if defined(BIT_HPP_X86_DISPATCH_)
+template <byte_code CODE>
+__attribute__((target("avx2"))) inline bool pack_bytes_avx2(
+    const unsigned char* src, uint64_t& bits) noexcept {
+  const __m256i zero = _mm256_set1_epi8(static_cast<char>(
+      byte_code_zero<CODE>()));
+  const __m256i one = _mm256_set1_epi8(1);
+  bits = 0;
+  for (size_t k = 0; k < 64; k += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k));
+    if (CODE != byte_code::high_bit) {
+      v = _mm256_xor_si256(v, zero);
+      const __m256i valid = _mm256_cmpeq_epi8(_mm256_min_epu8(v, one), v);
+      if (_mm256_movemask_epi8(valid) != -1) {
+        return false;
+      }
+      v = _mm256_slli_epi16(v, 7);
+    }
+    bits |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(v))) << k;
+  }
+  return true;
+}
+#endif
+
+#if defined(__SSE2__)
+template <byte_code CODE>
+inline bool pack_bytes_sse2(const unsigned char* src,
+                            uint64_t& bits) noexcept {
+  const __m128i zero = _mm_set1_epi8(static_cast<char>(
+      byte_code_zero<CODE>()));
+  const __m128i one = _mm_set1_epi8(1);
+  bits = 0;
+  for (size_t k = 0; k < 64; k += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k));
+    if (CODE != byte_code::high_bit) {
+      v = _mm_xor_si128(v, zero);
+      const __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(v, one), v);
+      if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
+      }
+      v = _mm_slli_epi16(v, 7);
+    }
+    bits |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(v))) << k;
+  }
+  return true;
+}
+
+// bits k to k + 15 as bytes, 0xFF for a one, no pdep (see cpu_has_avx2())
+inline __m128i expand_bits_sse2(uint64_t bits, size_t k) noexcept {
+  const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4,
+                                       8, 16, 32, 64, -128);
+  __m128i v = _mm_cvtsi32_si128(static_cast<int>((bits >> k) & 0xFFFF));
+  v = _mm_unpacklo_epi8(v, v);
+  v = _mm_unpacklo_epi16(v, v);
+  v = _mm_unpacklo_epi32(v, v);
+  return _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+}
+#endif
+
+/**
+ * @brief Bits of n (up to 64) bytes, byte k in bit k. A whole block takes
+ * a movemask per vector, false is returned for a byte that is not a code.
+ */
+template <byte_code CODE>
+inline bool pack_bytes(const unsigned char* src, size_t n,
+                       uint64_t& bits) noexcept {
+  if (n == 64) {
+#if defined(BIT_HPP_X86_DISPATCH_)
+    if (cpu_has_avx2()) {
+      return pack_bytes_avx2<CODE>(src, bits);
+    }
+#endif
+#if defined(__SSE2__)
+    return pack_bytes_sse2<CODE>(src, bits);
+#endif
+  }
+
+  bits = 0;
+  for (size_t k = 0; k < n; k += 8) {
+    uint64_t part;
+    if (!pack_bytes_scalar<CODE>(src + k, std::min<size_t>(8, n - k),
+                                 part)) {
+      return false;
+    }
+    bits |= part << k;
+  }
+  return true;
+}
+
+// n (up to 64) bits to bytes, bit k to byte k
+template <byte_code CODE>
+inline void unpack_bits(uint64_t bits, size_t n, unsigned char* dst) noexcept {
+  size_t k = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_set1_epi8(static_cast<char>(
+      byte_code_zero<CODE>()));
+  const __m128i one = _mm_set1_epi8(1);
+  for (; k + 16 <= n; k += 16) {
+    const __m128i v = _mm_and_si128(expand_bits_sse2(bits, k), one);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k),
+                     _mm_or_si128(v, zero));
+  }
+#endif
+  for (; k < n; k++) {
+    dst[k] = static_cast<unsigned char>(byte_code_zero<CODE>() |
+                                        ((bits >> k) & 1));
+  }
+}
+
+template <byte_code CODE, class T, bool MSB_TO_LSB, class ALLOCATOR>
+bit<T, MSB_TO_LSB, ALLOCATOR> pack(const unsigned char* src, size_t n,
+                                   const ALLOCATOR& allocator) {
+  bit<T, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.reserve(n);
+  for (size_t i = 0; i < n; i += 64) {
+    const size_t k = std::min<size_t>(64, n - i);
+    uint64_t bits;
+    if (!pack_bytes<CODE>(src + i, k, bits)) {
+      throw std::invalid_argument("input argument is not one or zero.");
+    }
+    result.push_bits(to_field<MSB_TO_LSB>(bits, k), static_cast<unsigned>(k));
+  }
+  return result;
+}
+
+template <byte_code CODE, class VIEW>
+void unpack(const VIEW& x, unsigned char* dst) {
+  const size_t n = x.size();
+  for (size_t i = 0; i < n; i += 64) {
+    const unsigned k = static_cast<unsigned>(std::min<size_t>(64, n - i));
+    const uint64_t bits =
+        from_field<view_order<VIEW>::value>(x.bits(i, k), k);
+    unpack_bits<CODE>(bits, k, dst + i);
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Bits from bool (or 0/1 byte) arrays, "0101" strings, sorted or
+ * unsorted index lists and SIMD compare masks.
+ *
+ * Byte arrays are packed 64 at a time with movemask, from 16 or 32 byte
+ * vectors, and pushed as one push_bits() field; the scalar fallback packs
+ * 8 bytes with one multiply. The to_ functions expand 16 bits at a time
+ * with a compare against the bit weights. std::invalid_argument is thrown
+ * for a byte other than 0/1 or '0'/'1'.
+ */
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_bools(
+    const uint8_t* data, size_t n, const ALLOCATOR& allocator = ALLOCATOR()) {
+  return detail::pack<detail::byte_code::zero_one, T, MSB_TO_LSB>(data, n,
+                                                                  allocator);
+}
+
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_bools(
+    const bool* data, size_t n, const ALLOCATOR& allocator = ALLOCATOR()) {
+  static_assert(sizeof(bool) == 1, "bool must be one byte.");
+  return detail::pack<detail::byte_code::zero_one, T, MSB_TO_LSB>(
+      reinterpret_cast<const unsigned char*>(data), n, allocator);
+}
+
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_bools(
+    const std::vector<bool>& v, const ALLOCATOR& allocator = ALLOCATOR()) {
+  // std::vector<bool> only exposes single bits
+  const size_t n = v.size();
+  bit<T, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.reserve(n);
+  for (size_t i = 0; i < n; i += 64) {
+    const size_t k = std::min<size_t>(64, n - i);
+    uint64_t bits = 0;
+    for (size_t j = 0; j < k; j++) {
+      bits |= uint64_t(v[i + j]) << j;
+    }
+    result.push_bits(detail::to_field<MSB_TO_LSB>(bits, k),
+                     static_cast<unsigned>(k));
+  }
+  return result;
+}
+
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_string(
+    const char* s, size_t n, const ALLOCATOR& allocator = ALLOCATOR()) {
+  return detail::pack<detail::byte_code::character, T, MSB_TO_LSB>(
+      reinterpret_cast<const unsigned char*>(s), n, allocator);
+}
+
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_string(
+    const std::string& s, const ALLOCATOR& allocator = ALLOCATOR()) {
+  return from_string<T, MSB_TO_LSB>(s.data(), s.size(), allocator);
+}
+
+// bytes with the top bit set are ones, as _mm_cmpeq_epi8() leaves them
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_mask(
+    const unsigned char* mask, size_t n,
+    const ALLOCATOR& allocator = ALLOCATOR()) {
+  return detail::pack<detail::byte_code::high_bit, T, MSB_TO_LSB>(mask, n,
+                                                                  allocator);
+}
+
+// size bits, ones at the count given positions
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_indices(
+    const size_t* indices, size_t count, size_t size,
+    const ALLOCATOR& allocator = ALLOCATOR()) {
+  typedef detail::bit_range<T, MSB_TO_LSB> range;
+
+  bit<T, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.resize(size);
+  T* data = result.data();
+  for (size_t i = 0; i < count; i++) {
+    const size_t position = indices[i];
+    if (position >= size) {
+      throw std::out_of_range("bit access is out of range.");
+    }
+    data[position / range::T_BIT_SIZE] |=
+        range::mask(position % range::T_BIT_SIZE);
+  }
+  return result;
+}
+
+template <class T = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> from_indices(
+    const std::vector<size_t>& indices, size_t size,
+    const ALLOCATOR& allocator = ALLOCATOR()) {
+  return from_indices<T, MSB_TO_LSB>(indices.data(), indices.size(), size,
+                                     allocator);
+}
+
+/**
+ * @brief The other way, for a bit or a bit_view. out holds x.size()
+ * elements.
+ */
+template <class BITS, class VIEW = detail::view_of<BITS>>
+void to_bools(const BITS& x, uint8_t* out) {
+  detail::unpack<detail::byte_code::zero_one>(x.sub_range(0, x.size()), out);
+}
+
+template <class BITS, class VIEW = detail::view_of<BITS>>
+void to_bools(const BITS& x, bool* out) {
+  detail::unpack<detail::byte_code::zero_one>(
+      x.sub_range(0, x.size()), reinterpret_cast<unsigned char*>(out));
+}
+
+template <class BITS, class VIEW = detail::view_of<BITS>>
+std::vector<bool> to_bools(const BITS& x) {
+  const VIEW view = x.sub_range(0, x.size());
+  const size_t n = view.size();
+  std::vector<bool> result(n);
+  for (size_t i = 0; i < n; i += 64) {
+    const unsigned k = static_cast<unsigned>(std::min<size_t>(64, n - i));
+    const uint64_t bits = detail::from_field<detail::view_order<VIEW>::value>(
+        view.bits(i, k), k);
+    for (size_t j = 0; j < k; j++) {
+      result[i + j] = ((bits >> j) & 1) != 0;
+    }
+  }
+  return result;
+}
+
+template <class BITS, class VIEW = detail::view_of<BITS>>
+std::string to_string(const BITS& x) {
+  std::string result(x.size(), '0');
+  detail::unpack<detail::byte_code::character>(
+      x.sub_range(0, x.size()), reinterpret_cast<unsigned char*>(&result[0]));
+  return result;
+}
+
+// positions of the ones, ascending
+template <class BITS, class VIEW = detail::view_of<BITS>>
+std::vector<size_t> to_indices(const BITS& x) {
+  const VIEW view = x.sub_range(0, x.size());
+  const size_t n = view.size();
+  std::vector<size_t> result;
+  result.reserve(view.count());
+  for (size_t i = 0; i < n; i += 64) {
+    const unsigned k = static_cast<unsigned>(std::min<size_t>(64, n - i));
+    uint64_t bits = detail::from_field<detail::view_order<VIEW>::value>(
+        view.bits(i, k), k);
+    for (; bits != 0; bits &= bits - 1) {
+      result.push_back(i + detail::countr_zero(bits));
+    }
+  }
+  return result;
+}
+}  // namespace jcy
+
+#endif  // BIT_CONVERT_HPP_
@@ -0,0 +1,528 @@
+/**
+ * @file bit_interleave.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BIT_INTERLEAVE_HPP_
+#define BIT_INTERLEAVE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+// words are gathered and scattered this many at a time
+constexpr size_t INTERLEAVE_BLOCK_SIZE = 64;
+
+// bits 0 to 31 of x to the even bits
+inline uint64_t spread_bits(uint64_t x) noexcept {
+  x &= 0x00000000FFFFFFFFull;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x << 2)) & 0x3333333333333333ull;
+  return (x | (x << 1)) & 0x5555555555555555ull;
+}
+
+// the even bits of x to bits 0 to 31
+inline uint64_t compact_bits(uint64_t x) noexcept {
+  x &= 0x5555555555555555ull;
+  x = (x | (x >> 1)) & 0x3333333333333333ull;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+  return (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+}
+
+/**
+ * @brief Words hold bits 64 * j to 64 * j + 63 with the first bit least
+ * significant. out[2 * j] and out[2 * j + 1] are a[j] and b[j] with the bits
+ * of a on the even positions, x splits the same way.
+ *
+ * The spreads are shifts and masks on 64-bit lanes, two (four) words per
+ * SSE2 (AVX2) instruction, not pdep/pext (see cpu_has_avx2()).
+ */
+inline void interleave_words_scalar(const uint64_t* a, const uint64_t* b,
+                                    size_t n, uint64_t* out) noexcept {
+  for (size_t j = 0; j < n; j++) {
+    out[2 * j] = spread_bits(a[j]) | (spread_bits(b[j]) << 1);
+    out[2 * j + 1] = spread_bits(a[j] >> 32) | (spread_bits(b[j] >> 32) << 1);
+  }
+}
+
+inline void deinterleave_words_scalar(const uint64_t* x, size_t n,
+                                      uint64_t* a, uint64_t* b) noexcept {
+  for (size_t j = 0; j < n; j++) {
+    a[j] = compact_bits(x[2 * j]) | (compact_bits(x[2 * j + 1]) << 32);
+    b[j] = compact_bits(x[2 * j] >> 1) |
+           (compact_bits(x[2 * j + 1] >> 1) << 32);
+  }
+}
+
+#if defined(__SSE2__)
+inline __m128i spread_bits_sse2(__m128i x) noexcept {
+  x = _mm_and_si128(x, _mm_set1_epi64x(0x00000000FFFFFFFFll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi64(x, 16)),
+                    _mm_set1_epi64x(0x0000FFFF0000FFFFll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi64(x, 8)),
+                    _mm_set1_epi64x(0x00FF00FF00FF00FFll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi64(x, 4)),
+                    _mm_set1_epi64x(0x0F0F0F0F0F0F0F0Fll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi64(x, 2)),
+                    _mm_set1_epi64x(0x3333333333333333ll));
+  return _mm_and_si128(_mm_or_si128(x, _mm_slli_epi64(x, 1)),
+                       _mm_set1_epi64x(0x5555555555555555ll));
+}
+
+inline __m128i compact_bits_sse2(__m128i x) noexcept {
+  x = _mm_and_si128(x, _mm_set1_epi64x(0x5555555555555555ll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 1)),
+                    _mm_set1_epi64x(0x3333333333333333ll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 2)),
+                    _mm_set1_epi64x(0x0F0F0F0F0F0F0F0Fll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 4)),
+                    _mm_set1_epi64x(0x00FF00FF00FF00FFll));
+  x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 8)),
+                    _mm_set1_epi64x(0x0000FFFF0000FFFFll));
+  return _mm_and_si128(_mm_or_si128(x, _mm_srli_epi64(x, 16)),
+                       _mm_set1_epi64x(0x00000000FFFFFFFFll));
+}
+
+inline void interleave_words_sse2(const uint64_t* a, const uint64_t* b,
+                                  size_t n, uint64_t* out) noexcept {
+  size_t j = 0;
+  for (; j + 2 <= n; j += 2) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + j));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+    const __m128i low = _mm_or_si128(
+        spread_bits_sse2(va), _mm_slli_epi64(spread_bits_sse2(vb), 1));
+    const __m128i high =
+        _mm_or_si128(spread_bits_sse2(_mm_srli_epi64(va, 32)),
+                     _mm_slli_epi64(spread_bits_sse2(_mm_srli_epi64(vb, 32)),
+                                    1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * j),
+                     _mm_unpacklo_epi64(low, high));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * j + 2),
+                     _mm_unpackhi_epi64(low, high));
+  }
+
+  interleave_words_scalar(a + j, b + j, n - j, out + 2 * j);
+}
+
+inline void deinterleave_words_sse2(const uint64_t* x, size_t n, uint64_t* a,
+                                    uint64_t* b) noexcept {
+  size_t j = 0;
+  for (; j + 2 <= n; j += 2) {
+    const __m128i first =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + 2 * j));
+    const __m128i second =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + 2 * j + 2));
+    for (int odd = 0; odd < 2; odd++) {
+      const __m128i c0 = compact_bits_sse2(_mm_srli_epi64(first, odd));
+      const __m128i c1 = compact_bits_sse2(_mm_srli_epi64(second, odd));
+      // the low halves are the even words, the high halves the odd ones
+      const __m128i v =
+          _mm_or_si128(_mm_unpacklo_epi64(c0, c1),
+                       _mm_slli_epi64(_mm_unpackhi_epi64(c0, c1), 32));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>((odd ? b : a) + j), v);
+    }
+  }
+
+  deinterleave_words_scalar(x + 2 * j, n - j, a + j, b + j);
+}
+#endif
+
+#if defined(BIT_HPP_X86_DISPATCH_)
+__attribute__((target("avx2"))) inline __m256i spread_bits_avx2(
+    __m256i x) noexcept {
+  x = _mm256_and_si256(x, _mm256_set1_epi64x(0x00000000FFFFFFFFll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi64(x, 16)),
+                       _mm256_set1_epi64x(0x0000FFFF0000FFFFll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi64(x, 8)),
+                       _mm256_set1_epi64x(0x00FF00FF00FF00FFll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi64(x, 4)),
+                       _mm256_set1_epi64x(0x0F0F0F0F0F0F0F0Fll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi64(x, 2)),
+                       _mm256_set1_epi64x(0x3333333333333333ll));
+  return _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi64(x, 1)),
+                          _mm256_set1_epi64x(0x5555555555555555ll));
+}
+
+__attribute__((target("avx2"))) inline __m256i compact_bits_avx2(
+    __m256i x) noexcept {
+  x = _mm256_and_si256(x, _mm256_set1_epi64x(0x5555555555555555ll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)),
+                       _mm256_set1_epi64x(0x3333333333333333ll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 2)),
+                       _mm256_set1_epi64x(0x0F0F0F0F0F0F0F0Fll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 4)),
+                       _mm256_set1_epi64x(0x00FF00FF00FF00FFll));
+  x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 8)),
+                       _mm256_set1_epi64x(0x0000FFFF0000FFFFll));
+  return _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 16)),
+                          _mm256_set1_epi64x(0x00000000FFFFFFFFll));
+}
+
+__attribute__((target("avx2"))) inline void interleave_words_avx2(
+    const uint64_t* a, const uint64_t* b, size_t n, uint64_t* out) noexcept {
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const __m256i va =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + j));
+    const __m256i vb =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+    const __m256i low = _mm256_or_si256(
+        spread_bits_avx2(va), _mm256_slli_epi64(spread_bits_avx2(vb), 1));
+    const __m256i high = _mm256_or_si256(
+        spread_bits_avx2(_mm256_srli_epi64(va, 32)),
+        _mm256_slli_epi64(spread_bits_avx2(_mm256_srli_epi64(vb, 32)), 1));
+    // unpack works within 128-bit lanes, words 0 and 2 then 1 and 3
+    const __m256i even = _mm256_unpacklo_epi64(low, high);
+    const __m256i odd = _mm256_unpackhi_epi64(low, high);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * j),
+                        _mm256_permute2x128_si256(even, odd, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * j + 4),
+                        _mm256_permute2x128_si256(even, odd, 0x31));
+  }
+
+  interleave_words_scalar(a + j, b + j, n - j, out + 2 * j);
+}
+
+__attribute__((target("avx2"))) inline void deinterleave_words_avx2(
+    const uint64_t* x, size_t n, uint64_t* a, uint64_t* b) noexcept {
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const __m256i first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + 2 * j));
+    const __m256i second =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + 2 * j + 4));
+    for (int odd = 0; odd < 2; odd++) {
+      const __m256i c0 = compact_bits_avx2(_mm256_srli_epi64(first, odd));
+      const __m256i c1 = compact_bits_avx2(_mm256_srli_epi64(second, odd));
+      // words 0, 2, 1 and 3 after the in-lane unpack
+      const __m256i v = _mm256_or_si256(
+          _mm256_unpacklo_epi64(c0, c1),
+          _mm256_slli_epi64(_mm256_unpackhi_epi64(c0, c1), 32));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>((odd ? b : a) + j),
+                          _mm256_permute4x64_epi64(v, 0xD8));
+    }
+  }
+
+  deinterleave_words_scalar(x + 2 * j, n - j, a + j, b + j);
+}
+#endif
+
+inline void interleave_words(const uint64_t* a, const uint64_t* b, size_t n,
+                             uint64_t* out) noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  if (cpu_has_avx2()) {
+    interleave_words_avx2(a, b, n, out);
+    return;
+  }
+#endif
+
+#if defined(__SSE2__)
+  interleave_words_sse2(a, b, n, out);
+#else
+  interleave_words_scalar(a, b, n, out);
+#endif
+}
+
+inline void deinterleave_words(const uint64_t* x, size_t n, uint64_t* a,
+                               uint64_t* b) noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  if (cpu_has_avx2()) {
+    deinterleave_words_avx2(x, n, a, b);
+    return;
+  }
+#endif
+
+#if defined(__SSE2__)
+  deinterleave_words_sse2(x, n, a, b);
+#else
+  deinterleave_words_scalar(x, n, a, b);
+#endif
+}
+
+// words of the n bits of x from position, the first bit least significant
+template <class VIEW>
+inline void gather_words(const VIEW& x, size_t position, size_t n,
+                         uint64_t* words) {
+  typedef typename VIEW::value_type value_type;
+  constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+
+  // from an element boundary the copy is a transcode, but for the bits
+  // after the view in the last element
+  const size_t first = x.offset() + position;
+  if ((n != 0) && (first % T_BIT_SIZE == 0)) {
+    bit_transcode<value_type, view_order<VIEW>::value, uint64_t,
+                  false>::copy(words, x.data() + first / T_BIT_SIZE, n);
+    if (n % 64 != 0) {
+      words[n / 64] &= (uint64_t(1) << (n % 64)) - 1;
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < n; i += 64) {
+    const unsigned k = static_cast<unsigned>(std::min<size_t>(64, n - i));
+    words[i / 64] =
+        from_field<view_order<VIEW>::value>(x.bits(position + i, k), k);
+  }
+}
+
+// n bits of words to data, from an element boundary
+template <class T, bool MSB_TO_LSB>
+inline void scatter_words(const uint64_t* words, size_t n, T* data) noexcept {
+  bit_transcode<uint64_t, false, T, MSB_TO_LSB>::copy(data, words, n);
+}
+
+/**
+ * @brief Transpose of the 8x8 bit matrix with row r in byte r: bit c of
+ * byte r moves to bit r of byte c.
+ */
+inline uint64_t transpose8(uint64_t x) noexcept {
+  uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+  return x ^ t ^ (t << 28);
+}
+
+/**
+ * @brief Transpose of the 64x64 bit matrix with row r in x[r]: bit c of
+ * x[r] moves to bit r of x[c]. The quadrants are swapped in place, then
+ * the quadrants of the quadrants, 6 rounds of 32 word swaps.
+ */
+inline void transpose64(uint64_t* x) noexcept {
+  uint64_t mask = 0x00000000FFFFFFFFull;
+  for (size_t j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+    for (size_t k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+      const uint64_t t = ((x[k] >> j) ^ x[k | j]) & mask;
+      x[k] ^= t << j;
+      x[k | j] ^= t;
+    }
+  }
+}
+
+/**
+ * @brief planes[p] gets bit 7 - p of each of n (up to 64) bytes, byte i in
+ * bit i. A movemask takes the top bit of 16 (32) bytes at once, the bytes
+ * are then doubled to bring up the next bit.
+ */
+inline void byte_planes_scalar(const uint8_t* bytes, size_t n,
+                               uint64_t* planes) noexcept {
+  std::fill(planes, planes + 8, uint64_t(0));
+  for (size_t i = 0; i < n; i += 8) {
+    uint64_t rows = 0;
+    for (size_t r = 0; (r < 8) && (i + r < n); r++) {
+      rows |= uint64_t(bytes[i + r]) << (8 * r);
+    }
+    const uint64_t columns = transpose8(rows);
+    for (size_t p = 0; p < 8; p++) {
+      planes[p] |= ((columns >> (8 * (7 - p))) & 0xFF) << i;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+inline void byte_planes_sse2(const uint8_t* bytes, size_t n,
+                             uint64_t* planes) noexcept {
+  if (n != 64) {
+    byte_planes_scalar(bytes, n, planes);
+    return;
+  }
+
+  std::fill(planes, planes + 8, uint64_t(0));
+  for (size_t i = 0; i < 64; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+    for (size_t p = 0; p < 8; p++) {
+      planes[p] |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(v))) << i;
+      v = _mm_add_epi8(v, v);
+    }
+  }
+}
+#endif
+
+#if defined(BIT_HPP_X86_DISPATCH_)
+__attribute__((target("avx2"))) inline void byte_planes_avx2(
+    const uint8_t* bytes, uint64_t* planes) noexcept {
+  std::fill(planes, planes + 8, uint64_t(0));
+  for (size_t i = 0; i < 64; i += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+    for (size_t p = 0; p < 8; p++) {
+      planes[p] |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(v)))
+                   << i;
+      v = _mm256_add_epi8(v, v);
+    }
+  }
+}
+#endif
+
+inline void byte_planes(const uint8_t* bytes, size_t n,
+                        uint64_t* planes) noexcept {
+#if defined(BIT_HPP_X86_DISPATCH_)
+  if ((n == 64) && cpu_has_avx2()) {
+    byte_planes_avx2(bytes, planes);
+    return;
+  }
+#endif
+
+#if defined(__SSE2__)
+  byte_planes_sse2(bytes, n, planes);
+#else
+  byte_planes_scalar(bytes, n, planes);
+#endif
+}
+
+// planes[p] gets bit W - 1 - p of each of n (up to 64) W-bit words
+template <class WORD>
+inline void word_planes(const WORD* words, size_t n,
+                        uint64_t* planes) noexcept {
+  constexpr size_t W = 8 * sizeof(WORD);
+  uint64_t rows[64] = {};
+  for (size_t i = 0; i < n; i++) rows[i] = words[i];
+  transpose64(rows);
+  for (size_t p = 0; p < W; p++) planes[p] = rows[W - 1 - p];
+}
+
+inline void word_planes(const uint8_t* words, size_t n,
+                        uint64_t* planes) noexcept {
+  byte_planes(words, n, planes);
+}
+}  // namespace detail
+
+/**
+ * @brief Bits of a and b alternated, a first: bit 2i is a[i] and bit
+ * 2i + 1 is b[i], the Morton (Z-order) code of two coordinates. a and b
+ * have the same size.
+ */
+template <class BITS, class VIEW = detail::view_of<BITS>>
+bit<typename VIEW::value_type, detail::view_order<VIEW>::value> interleave(
+    const BITS& a, const BITS& b) {
+  const VIEW first = a.sub_range(0, a.size());
+  const VIEW second = b.sub_range(0, b.size());
+  if (first.size() != second.size()) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
+
+  constexpr size_t BLOCK_BIT_SIZE = 64 * detail::INTERLEAVE_BLOCK_SIZE;
+  uint64_t words[2][detail::INTERLEAVE_BLOCK_SIZE];
+  uint64_t out[2 * detail::INTERLEAVE_BLOCK_SIZE];
+
+  typedef typename VIEW::value_type value_type;
+  constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+
+  const size_t n = first.size();
+  bit<value_type, detail::view_order<VIEW>::value> result;
+  result.resize(2 * n);
+  value_type* data = result.data();
+  for (size_t i = 0; i < n; i += BLOCK_BIT_SIZE) {
+    const size_t k = std::min(BLOCK_BIT_SIZE, n - i);
+    const size_t count = (k + 63) / 64;
+    detail::gather_words(first, i, k, words[0]);
+    detail::gather_words(second, i, k, words[1]);
+    detail::interleave_words(words[0], words[1], count, out);
+    detail::scatter_words<value_type, detail::view_order<VIEW>::value>(
+        out, 2 * k, data + 2 * i / T_BIT_SIZE);
+  }
+  return result;
+}
+
+/**
+ * @brief The even and the odd bits of x, undoing interleave(). x has an
+ * even size.
+ */
+template <class BITS, class VIEW = detail::view_of<BITS>>
+std::pair<bit<typename VIEW::value_type, detail::view_order<VIEW>::value>,
+          bit<typename VIEW::value_type, detail::view_order<VIEW>::value>>
+deinterleave(const BITS& x) {
+  const VIEW view = x.sub_range(0, x.size());
+  if (view.size() % 2 != 0) {
+    throw std::invalid_argument("bit size is not even.");
+  }
+
+  constexpr size_t BLOCK_BIT_SIZE = 64 * detail::INTERLEAVE_BLOCK_SIZE;
+  uint64_t words[2 * detail::INTERLEAVE_BLOCK_SIZE];
+  uint64_t out[2][detail::INTERLEAVE_BLOCK_SIZE];
+
+  typedef typename VIEW::value_type value_type;
+  constexpr bool MSB_TO_LSB = detail::view_order<VIEW>::value;
+  constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+
+  const size_t n = view.size() / 2;
+  std::pair<bit<value_type, MSB_TO_LSB>, bit<value_type, MSB_TO_LSB>> result;
+  result.first.resize(n);
+  result.second.resize(n);
+  value_type* even = result.first.data();
+  value_type* odd = result.second.data();
+  for (size_t i = 0; i < n; i += BLOCK_BIT_SIZE) {
+    const size_t k = std::min(BLOCK_BIT_SIZE, n - i);
+    const size_t count = (k + 63) / 64;
+    // the last word is not gathered when k ends in its first half
+    words[2 * count - 1] = 0;
+    detail::gather_words(view, 2 * i, 2 * k, words);
+    detail::deinterleave_words(words, count, out[0], out[1]);
+    detail::scatter_words<value_type, MSB_TO_LSB>(out[0], k,
+                                                  even + i / T_BIT_SIZE);
+    detail::scatter_words<value_type, MSB_TO_LSB>(out[1], k,
+                                                  odd + i / T_BIT_SIZE);
+  }
+  return result;
+}
+
+/**
+ * @brief Bit planes of n unsigned words, the most significant plane first:
+ * bit i of plane p is bit W - 1 - p of words[i], W the bits of WORD. planes
+ * is replaced by the W planes of n bits each.
+ *
+ * Blocks of 64 words are transposed at once, bytes with a movemask per bit
+ * and wider words as a 64x64 bit matrix.
+ */
+template <class WORD, class T, bool MSB_TO_LSB, class ALLOCATOR>
+void transpose_planes(const WORD* words, size_t n,
+                      bit<T, MSB_TO_LSB, ALLOCATOR>& planes) {
+  static_assert(std::is_unsigned<WORD>::value && (sizeof(WORD) <= 8),
+                "words are unsigned and up to 64 bits.");
+  constexpr size_t W = 8 * sizeof(WORD);
+
+  // the planes a word at a time, plane p from bit p * n
+  const size_t size = W * n;
+  std::vector<uint64_t> out((size + 63) / 64 + 1, 0);
+  uint64_t block[W];
+  for (size_t j = 0; 64 * j < n; j++) {
+    detail::word_planes(words + 64 * j, std::min<size_t>(64, n - 64 * j),
+                        block);
+    for (size_t p = 0; p < W; p++) {
+      const size_t position = p * n + 64 * j;
+      const size_t shift = position % 64;
+      out[position / 64] |= block[p] << shift;
+      if (shift != 0) {
+        out[position / 64 + 1] |= block[p] >> (64 - shift);
+      }
+    }
+  }
+
+  planes.clear();
+  planes.resize(size);
+  if (size != 0) {
+    detail::scatter_words<T, MSB_TO_LSB>(out.data(), size, planes.data());
+  }
+}
+}  // namespace jcy
+
+#endif  // BIT_INTERLEAVE_HPP_
@@ -0,0 +1,387 @@
+/**
+ * @file bit_serialize.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BIT_SERIALIZE_HPP_
+#define BIT_SERIALIZE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+/**
+ * @brief Serialized bit layout, every field is little endian.
+ *
+ *   offset  0  magic "JCYBITS\0"
+ *   offset  8  version, 16 bits
+ *   offset 10  element size in bytes, 8 bits
+ *   offset 11  flags, 8 bits, bit 0 set for MSB_TO_LSB
+ *   offset 12  reserved, 32 bits of zero
+ *   offset 16  size in bits, 64 bits
+ *   offset 24  checksum of the payload, 64 bits
+ *   offset 32  payload, the buffer elements, each little endian
+ *
+ * The payload starts 32 bytes in, so on a little endian host the elements
+ * of an aligned buffer can be used where they are.
+ */
+struct serialized_header {
+  static constexpr unsigned char MAGIC[8] = {'J', 'C', 'Y', 'B',
+                                             'I', 'T', 'S', 0};
+  static constexpr uint16_t VERSION = 1;
+  static constexpr uint8_t MSB_TO_LSB_FLAG = 0x01;
+  static constexpr size_t SIZE = 32;
+
+  uint16_t version;
+  uint8_t element_size;
+  uint8_t flags;
+  uint64_t size;  // in bits
+  uint64_t checksum;
+};
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && \
+                          __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+constexpr bool HOST_LITTLE_ENDIAN = true;
+#else
+constexpr bool HOST_LITTLE_ENDIAN = false;
+#endif
+
+// stream payloads are read this many bytes at a time, a multiple of any T
+constexpr size_t SERIALIZED_READ_CHUNK = 64 * 1024;
+
+inline void store_little_endian(unsigned char* bytes, uint64_t value,
+                                size_t n) noexcept {
+  for (size_t k = 0; k < n; k++) {
+    bytes[k] = static_cast<unsigned char>(value >> (8 * k));
+  }
+}
+
+inline uint64_t checksum_mix(uint64_t h, uint64_t word) noexcept {
+  h = (h ^ word) * 0x100000001B3ull;
+  return h ^ (h >> 32);
+}
+
+/**
+ * @brief Checksum of n serialized bytes.
+ *
+ * FNV-1a style mixing of 64-bit little endian words, the last word zero
+ * padded. Words go round robin to four lanes, so the multiplies of
+ * neighbouring words do not wait on each other.
+ */
+inline uint64_t serialized_checksum(const unsigned char* bytes,
+                                    size_t n) noexcept {
+  uint64_t lanes[4] = {0xCBF29CE484222325ull, 0x84222325CBF29CE4ull,
+                       0xE484222325CBF29Cull, 0x2325CBF29CE48422ull};
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    for (size_t k = 0; k < 4; k++) {
+      lanes[k] = checksum_mix(lanes[k],
+                              load_element<uint64_t, false>(bytes + i + 8 * k));
+    }
+  }
+
+  for (size_t k = 0; i < n; i += 8, k++) {
+    unsigned char word[8] = {};
+    std::memcpy(word, bytes + i, std::min<size_t>(8, n - i));
+    lanes[k] = checksum_mix(lanes[k], load_element<uint64_t, false>(word));
+  }
+
+  uint64_t h = checksum_mix(lanes[0], n);
+  for (size_t k = 1; k < 4; k++) h = checksum_mix(h, lanes[k]);
+  return h;
+}
+
+inline void write_serialized_header(unsigned char* bytes,
+                                    const serialized_header& h) noexcept {
+  std::memcpy(bytes, serialized_header::MAGIC, 8);
+  store_little_endian(bytes + 8, h.version, 2);
+  bytes[10] = h.element_size;
+  bytes[11] = h.flags;
+  store_little_endian(bytes + 12, 0, 4);
+  store_little_endian(bytes + 16, h.size, 8);
+  store_little_endian(bytes + 24, h.checksum, 8);
+}
+
+// header of a T/MSB_TO_LSB bit, the payload size in bytes is returned
+template <class T, bool MSB_TO_LSB>
+size_t read_serialized_header(const unsigned char* bytes,
+                              serialized_header& h) {
+  if (std::memcmp(bytes, serialized_header::MAGIC, 8) != 0) {
+    throw std::invalid_argument("serialized bit header is not recognized.");
+  }
+
+  h.version = static_cast<uint16_t>(load_element<uint16_t, false>(bytes + 8));
+  h.element_size = bytes[10];
+  h.flags = bytes[11];
+  h.size = load_element<uint64_t, false>(bytes + 16);
+  h.checksum = load_element<uint64_t, false>(bytes + 24);
+
+  if (h.version != serialized_header::VERSION) {
+    throw std::invalid_argument("serialized bit version is not supported.");
+  }
+  if (h.element_size != sizeof(T)) {
+    throw std::invalid_argument(
+        "serialized bit element size does not match.");
+  }
+  if (((h.flags & serialized_header::MSB_TO_LSB_FLAG) != 0) != MSB_TO_LSB) {
+    throw std::invalid_argument("serialized bit order does not match.");
+  }
+
+  const uint64_t t_bit_size = 8 * sizeof(T);
+  return static_cast<size_t>((h.size / t_bit_size) +
+                             (h.size % t_bit_size != 0)) *
+         sizeof(T);
+}
+
+// elements from (or to) the little endian payload layout
+template <class T>
+void load_serialized(T* dst, const unsigned char* src, size_t count) noexcept {
+  if (HOST_LITTLE_ENDIAN) {
+    std::memcpy(dst, src, count * sizeof(T));
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = load_element<T, false>(src + i * sizeof(T));
+  }
+}
+
+template <class T>
+void store_serialized(unsigned char* dst, const T* src,
+                      size_t count) noexcept {
+  if (HOST_LITTLE_ENDIAN) {
+    std::memcpy(dst, src, count * sizeof(T));
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    store_little_endian(dst + i * sizeof(T), src[i], sizeof(T));
+  }
+}
+
+// a writer may leave garbage past the last bit, a bit keeps it zero
+template <class T, bool MSB_TO_LSB>
+void clear_serialized_padding(T* data, size_t size) noexcept {
+  typedef bit_range<T, MSB_TO_LSB> range;
+  const size_t r = size % range::T_BIT_SIZE;
+  if (r != 0) {
+    const uint64_t keep = MSB_TO_LSB ? ~range::low_mask(range::T_BIT_SIZE - r)
+                                     : range::low_mask(r);
+    data[size / range::T_BIT_SIZE] &= static_cast<T>(keep);
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Bytes written by serialize(x), header included.
+ */
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t serialized_size(const bit<T, MSB_TO_LSB, ALLOCATOR>& x) noexcept {
+  return detail::serialized_header::SIZE + x.buffer_element_count() * sizeof(T);
+}
+
+/**
+ * @brief Write x to a caller buffer of n bytes in the serialized layout.
+ * Returns the bytes written, serialized_size(x).
+ */
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t serialize(const bit<T, MSB_TO_LSB, ALLOCATOR>& x, void* buffer,
+                 size_t n) {
+  const size_t total = serialized_size(x);
+  if (n < total) {
+    throw std::out_of_range("serialize buffer is too small.");
+  }
+
+  unsigned char* bytes = static_cast<unsigned char*>(buffer);
+  unsigned char* payload = bytes + detail::serialized_header::SIZE;
+  const size_t payload_size = total - detail::serialized_header::SIZE;
+  detail::store_serialized(payload, x.data(), x.buffer_element_count());
+
+  detail::serialized_header h;
+  h.version = detail::serialized_header::VERSION;
+  h.element_size = sizeof(T);
+  h.flags = MSB_TO_LSB ? detail::serialized_header::MSB_TO_LSB_FLAG : 0;
+  h.size = x.size();
+  h.checksum = detail::serialized_checksum(payload, payload_size);
+  detail::write_serialized_header(bytes, h);
+  return total;
+}
+
+/**
+ * @brief Write x to a stream in the serialized layout.
+ */
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void serialize(const bit<T, MSB_TO_LSB, ALLOCATOR>& x, std::ostream& os) {
+  const size_t payload_size = x.buffer_element_count() * sizeof(T);
+
+  // the elements already have the payload layout on little endian hosts
+  std::vector<unsigned char> copy;
+  const unsigned char* payload =
+      reinterpret_cast<const unsigned char*>(x.data());
+  if (!detail::HOST_LITTLE_ENDIAN) {
+    copy.resize(payload_size);
+    detail::store_serialized(copy.data(), x.data(), x.buffer_element_count());
+    payload = copy.data();
+  }
+
+  detail::serialized_header h;
+  h.version = detail::serialized_header::VERSION;
+  h.element_size = sizeof(T);
+  h.flags = MSB_TO_LSB ? detail::serialized_header::MSB_TO_LSB_FLAG : 0;
+  h.size = x.size();
+  h.checksum = detail::serialized_checksum(payload, payload_size);
+
+  unsigned char header[detail::serialized_header::SIZE];
+  detail::write_serialized_header(header, h);
+  os.write(reinterpret_cast<const char*>(header), sizeof(header));
+  os.write(reinterpret_cast<const char*>(payload),
+           static_cast<std::streamsize>(payload_size));
+}
+
+/**
+ * @brief Read a bit written by serialize() from n bytes.
+ * std::invalid_argument is thrown for a header of another element type or
+ * order, a truncated payload or a checksum mismatch.
+ */
+template <class T, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> deserialize(
+    const void* buffer, size_t n, const ALLOCATOR& allocator = ALLOCATOR()) {
+  if (n < detail::serialized_header::SIZE) {
+    throw std::invalid_argument("serialized bit is truncated.");
+  }
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(buffer);
+  detail::serialized_header h;
+  const size_t payload_size =
+      detail::read_serialized_header<T, MSB_TO_LSB>(bytes, h);
+  const unsigned char* payload = bytes + detail::serialized_header::SIZE;
+  if (n - detail::serialized_header::SIZE < payload_size) {
+    throw std::invalid_argument("serialized bit is truncated.");
+  }
+  if (detail::serialized_checksum(payload, payload_size) != h.checksum) {
+    throw std::invalid_argument("serialized bit checksum does not match.");
+  }
+
+  bit<T, MSB_TO_LSB, ALLOCATOR> x(allocator);
+  x.resize(static_cast<size_t>(h.size));
+  detail::load_serialized(x.data(), payload, x.buffer_element_count());
+  detail::clear_serialized_padding<T, MSB_TO_LSB>(x.data(), x.size());
+  return x;
+}
+
+/**
+ * @brief Read a bit written by serialize() from a stream. Memory follows
+ * the payload bytes actually read, so a forged header size can not force a
+ * large allocation.
+ */
+template <class T, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<T>>
+bit<T, MSB_TO_LSB, ALLOCATOR> deserialize(
+    std::istream& is, const ALLOCATOR& allocator = ALLOCATOR()) {
+  unsigned char header[detail::serialized_header::SIZE];
+  if (!is.read(reinterpret_cast<char*>(header), sizeof(header))) {
+    throw std::invalid_argument("serialized bit is truncated.");
+  }
+
+  detail::serialized_header h;
+  const size_t payload_size =
+      detail::read_serialized_header<T, MSB_TO_LSB>(header, h);
+
+  // the header size is not trusted, x grows a chunk at a time as the
+  // payload arrives, straight into the elements on little endian hosts
+  bit<T, MSB_TO_LSB, ALLOCATOR> x(allocator);
+  std::vector<unsigned char> copy;
+  for (size_t read = 0; read < payload_size;) {
+    const size_t k =
+        std::min(detail::SERIALIZED_READ_CHUNK, payload_size - read);
+    unsigned char* chunk;
+    if (detail::HOST_LITTLE_ENDIAN) {
+      x.resize(static_cast<size_t>(
+          std::min<uint64_t>(h.size, 8 * uint64_t(read + k))));
+      chunk = reinterpret_cast<unsigned char*>(x.data()) + read;
+    } else {
+      copy.resize(read + k);
+      chunk = copy.data() + read;
+    }
+    if (!is.read(reinterpret_cast<char*>(chunk),
+                 static_cast<std::streamsize>(k))) {
+      throw std::invalid_argument("serialized bit is truncated.");
+    }
+    read += k;
+  }
+
+  const unsigned char* payload =
+      detail::HOST_LITTLE_ENDIAN
+          ? reinterpret_cast<const unsigned char*>(x.data())
+          : copy.data();
+  if (detail::serialized_checksum(payload, payload_size) != h.checksum) {
+    throw std::invalid_argument("serialized bit checksum does not match.");
+  }
+
+  if (!detail::HOST_LITTLE_ENDIAN) {
+    x.resize(static_cast<size_t>(h.size));
+    detail::load_serialized(x.data(), payload, x.buffer_element_count());
+  }
+  detail::clear_serialized_padding<T, MSB_TO_LSB>(x.data(), x.size());
+  return x;
+}
+
+/**
+ * @brief A bit_view over the payload of n serialized bytes, nothing is
+ * copied.
+ *
+ * The buffer must outlive the view. Multi-byte elements can only be used
+ * in place on a little endian host and when the payload is aligned for T,
+ * which it is when the buffer is; std::invalid_argument is thrown
+ * otherwise, use deserialize() there. The checksum pass reads the whole
+ * payload once and can be skipped for trusted buffers.
+ */
+template <class T, bool MSB_TO_LSB = true>
+bit_view<T, MSB_TO_LSB, void> serialized_view(const void* buffer, size_t n,
+                                              bool verify = true) {
+  if (n < detail::serialized_header::SIZE) {
+    throw std::invalid_argument("serialized bit is truncated.");
+  }
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(buffer);
+  detail::serialized_header h;
+  const size_t payload_size =
+      detail::read_serialized_header<T, MSB_TO_LSB>(bytes, h);
+  const unsigned char* payload = bytes + detail::serialized_header::SIZE;
+  if (n - detail::serialized_header::SIZE < payload_size) {
+    throw std::invalid_argument("serialized bit is truncated.");
+  }
+  if ((sizeof(T) != 1) && !detail::HOST_LITTLE_ENDIAN) {
+    throw std::invalid_argument(
+        "serialized bit can not be viewed on this host.");
+  }
+  if (reinterpret_cast<uintptr_t>(payload) % alignof(T) != 0) {
+    throw std::invalid_argument("serialized bit payload is not aligned.");
+  }
+  if (verify &&
+      (detail::serialized_checksum(payload, payload_size) != h.checksum)) {
+    throw std::invalid_argument("serialized bit checksum does not match.");
+  }
+
+  // padding is not cleared here, but no bit_view algorithm reads it
+  return bit_view<T, MSB_TO_LSB, void>(reinterpret_cast<const T*>(payload), 0,
+                                       static_cast<size_t>(h.size));
+}
+}  // namespace jcy
+
+#endif  // BIT_SERIALIZE_HPP_
@@ -0,0 +1,142 @@
+/**
+ * @file bit_stream_builder.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef BIT_STREAM_BUILDER_HPP_
+#define BIT_STREAM_BUILDER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "bit.hpp"
+#include "thread_pool.hpp"
+
+namespace jcy {
+/**
+ * @brief Joins bits written by several threads into one stream.
+ *
+ * Each segment is an ordinary bit that one thread writes through
+ * writer(i), with no locking. finalize() takes the output offset of every
+ * segment from a prefix sum of the sizes and shift-copies the segments
+ * into one buffer on a thread pool. A task fills the output elements
+ * starting inside its segment, reading on into the next segments for the
+ * last one, so no element is written by two threads.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class ALLOCATOR = std::allocator<BUFFER_ELEMENT_TYPE>>
+class bit_stream_builder {
+ public:
+  typedef bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR> bit_type;
+  typedef size_t size_type;
+
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(BUFFER_ELEMENT_TYPE);
+
+ public:
+  // constructor, the segments and the result use allocator
+  explicit bit_stream_builder(size_type segment_count,
+                              const ALLOCATOR& allocator = ALLOCATOR());
+
+  size_type segment_count() const noexcept;
+
+  // segment i, each segment must only be used by one thread at a time
+  bit_type& writer(size_type i);
+  const bit_type& writer(size_type i) const;
+
+  // all segments in order, the segments are left as they are
+  bit_type finalize(thread_pool& pool = thread_pool::global()) const;
+
+  void clear() noexcept;
+
+ private:
+  std::vector<bit_type> segments_;
+  ALLOCATOR allocator_;
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                   ALLOCATOR>::bit_stream_builder(size_type segment_count,
+                                                  const ALLOCATOR& allocator)
+    : segments_(segment_count, bit_type(allocator)), allocator_(allocator) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+typename bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                            ALLOCATOR>::size_type
+bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                   ALLOCATOR>::segment_count() const noexcept {
+  return segments_.size();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+typename bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                            ALLOCATOR>::bit_type&
+bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>::writer(
+    size_type i) {
+  return segments_.at(i);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+const typename bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                                  ALLOCATOR>::bit_type&
+bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>::writer(
+    size_type i) const {
+  return segments_.at(i);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+typename bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                            ALLOCATOR>::bit_type
+bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>::finalize(
+    thread_pool& pool) const {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  const size_type count = segments_.size();
+  std::vector<size_type> offsets(count + 1, 0);
+  for (size_type i = 0; i < count; i++) {
+    offsets[i + 1] = offsets[i] + segments_[i].size();
+  }
+
+  const size_type total = offsets[count];
+  bit_type result(allocator_);
+  result.resize(total);
+  BIT_CONTAINER_TYPE* data = result.data();
+
+  pool.parallel_for(count, [&](size_type i) {
+    // the elements whose first bit comes from segment i
+    const size_type begin =
+        (offsets[i] + T_BIT_SIZE - 1) / T_BIT_SIZE * T_BIT_SIZE;
+    if (begin >= offsets[i + 1]) {
+      return;
+    }
+    const size_type end = std::min(
+        total, (offsets[i + 1] + T_BIT_SIZE - 1) / T_BIT_SIZE * T_BIT_SIZE);
+
+    size_type position = begin;
+    for (size_type j = i; position < end; j++) {
+      const size_type n = std::min(end, offsets[j + 1]) - position;
+      range::copy(data, position, segments_[j].data(), position - offsets[j],
+                  n);
+      position += n;
+    }
+  });
+
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class ALLOCATOR>
+void bit_stream_builder<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>::clear()
+    noexcept {
+  for (bit_type& segment : segments_) segment.clear();
+}
+}  // namespace jcy
+
+#endif  // BIT_STREAM_BUILDER_HPP_
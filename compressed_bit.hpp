@@ -0,0 +1,730 @@
+/**
+ * @file compressed_bit.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef COMPRESSED_BIT_HPP_
+#define COMPRESSED_BIT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+/**
+ * @brief The bits of one 65536-bit chunk of a compressed_bit.
+ *
+ * A chunk is kept as a sorted array of positions, as runs of ones or as
+ * 1024 words, whichever is smallest. In a word the bit of position j comes
+ * at the place it has in a 64-bit element of bit<uint64_t, MSB_TO_LSB>, so
+ * words convert to and from a bit buffer as plain fields.
+ */
+template <bool MSB_TO_LSB>
+struct bit_container {
+  enum class kind { array, bitmap, run };
+
+  static constexpr size_t BIT_SIZE = 65536;
+  static constexpr size_t WORD_COUNT = BIT_SIZE / 64;
+  static constexpr size_t ARRAY_LIMIT = 4096;
+
+  typedef std::array<uint64_t, WORD_COUNT> words_type;
+
+  kind type = kind::array;
+  uint32_t cardinality = 0;
+  std::vector<uint16_t> values;  // positions, or start and length - 1 pairs
+  std::vector<uint64_t> words;
+
+  static constexpr uint64_t word_mask(unsigned j) noexcept {
+    return uint64_t(1) << (MSB_TO_LSB ? 63 - j : j);
+  }
+
+  // ones at positions [a, b) of a word, a < b <= 64
+  static constexpr uint64_t range_mask(unsigned a, unsigned b) noexcept {
+    if (MSB_TO_LSB) {
+      return (~uint64_t(0) >> a) & ~(b == 64 ? 0 : ~uint64_t(0) >> b);
+    }
+    return (b == 64 ? ~uint64_t(0) : (uint64_t(1) << b) - 1) &
+           ~((uint64_t(1) << a) - 1);
+  }
+
+  // first position of the word, w must not be zero
+  static unsigned first_in_word(uint64_t w) noexcept {
+    return MSB_TO_LSB ? countl_zero(w) : countr_zero(w);
+  }
+
+  // first one (or zero) at or after pos, BIT_SIZE when there is none
+  static size_t find_in_words(const uint64_t* w, size_t pos,
+                              bool one) noexcept {
+    size_t i = pos / 64;
+    if (i >= WORD_COUNT) {
+      return BIT_SIZE;
+    }
+
+    uint64_t x = (one ? w[i] : ~w[i]) & range_mask(pos % 64, 64);
+    while (x == 0) {
+      if (++i == WORD_COUNT) {
+        return BIT_SIZE;
+      }
+      x = one ? w[i] : ~w[i];
+    }
+    return i * 64 + first_in_word(x);
+  }
+
+  static void fill_words(uint64_t* w, size_t begin, size_t end) noexcept {
+    while (begin < end) {
+      const size_t i = begin / 64;
+      const unsigned a = static_cast<unsigned>(begin % 64);
+      const unsigned b =
+          static_cast<unsigned>(std::min<size_t>(end - i * 64, 64));
+      w[i] |= range_mask(a, b);
+      begin = i * 64 + b;
+    }
+  }
+
+  size_t run_count() const noexcept { return values.size() / 2; }
+
+  size_t byte_size() const noexcept {
+    return values.size() * sizeof(uint16_t) + words.size() * sizeof(uint64_t);
+  }
+
+  bool test(uint32_t low) const noexcept {
+    switch (type) {
+      case kind::array:
+        return std::binary_search(values.begin(), values.end(), low);
+      case kind::bitmap:
+        return (words[low / 64] & word_mask(low % 64)) != 0;
+      default: {
+        const size_t r = find_run(low);
+        return (r != run_count()) &&
+               (low <= uint32_t(values[2 * r]) + values[2 * r + 1]);
+      }
+    }
+  }
+
+  // last run starting at or before low, run_count() when there is none
+  size_t find_run(uint32_t low) const noexcept {
+    size_t first = 0;
+    size_t count = run_count();
+    while (count > 0) {
+      const size_t half = count / 2;
+      if (values[2 * (first + half)] <= low) {
+        first += half + 1;
+        count -= half + 1;
+      } else {
+        count = half;
+      }
+    }
+    return first == 0 ? run_count() : first - 1;
+  }
+
+  // ones in [0, low), low is 0 to BIT_SIZE
+  uint32_t rank(uint32_t low) const noexcept {
+    switch (type) {
+      case kind::array:
+        return static_cast<uint32_t>(
+            std::lower_bound(values.begin(), values.end(), low) -
+            values.begin());
+      case kind::bitmap: {
+        uint32_t n = 0;
+        for (size_t i = 0; i < low / 64; i++) n += popcount(words[i]);
+        if (low % 64 != 0) {
+          n += popcount(words[low / 64] & range_mask(0, low % 64));
+        }
+        return n;
+      }
+      default: {
+        uint32_t n = 0;
+        for (size_t r = 0; r < run_count(); r++) {
+          const uint32_t start = values[2 * r];
+          if (start >= low) {
+            break;
+          }
+          n += std::min<uint32_t>(values[2 * r + 1] + 1, low - start);
+        }
+        return n;
+      }
+    }
+  }
+
+  void to_words(uint64_t* w) const noexcept {
+    switch (type) {
+      case kind::array:
+        std::fill(w, w + WORD_COUNT, uint64_t(0));
+        for (uint16_t v : values) w[v / 64] |= word_mask(v % 64);
+        break;
+      case kind::bitmap:
+        std::copy(words.begin(), words.end(), w);
+        break;
+      default:
+        std::fill(w, w + WORD_COUNT, uint64_t(0));
+        for (size_t r = 0; r < run_count(); r++) {
+          const size_t start = values[2 * r];
+          fill_words(w, start, start + values[2 * r + 1] + 1);
+        }
+        break;
+    }
+  }
+
+  template <class FUNCTION>
+  void for_each(FUNCTION f) const {
+    switch (type) {
+      case kind::array:
+        for (uint16_t v : values) f(uint32_t(v));
+        break;
+      case kind::bitmap:
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+          for (uint64_t x = words[i]; x != 0;) {
+            const unsigned j = first_in_word(x);
+            f(static_cast<uint32_t>(i * 64 + j));
+            x &= ~word_mask(j);
+          }
+        }
+        break;
+      default:
+        for (size_t r = 0; r < run_count(); r++) {
+          const uint32_t start = values[2 * r];
+          for (uint32_t v = 0; v <= values[2 * r + 1]; v++) f(start + v);
+        }
+        break;
+    }
+  }
+
+  // the smallest container holding the ones of w
+  static bit_container from_words(const uint64_t* w) {
+    bit_container c;
+    size_t runs = 0;
+    uint64_t carry = 0;  // last position of the previous word
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+      c.cardinality += popcount(w[i]);
+      const uint64_t before = MSB_TO_LSB ? (w[i] >> 1) | (carry << 63)
+                                         : (w[i] << 1) | (carry >> 63);
+      runs += popcount(w[i] & ~before);
+      carry = w[i];
+    }
+
+    if (runs * 4 < std::min<size_t>(2 * c.cardinality, 8 * WORD_COUNT)) {
+      c.type = kind::run;
+      c.values.reserve(2 * runs);
+      size_t start = find_in_words(w, 0, true);
+      while (start != BIT_SIZE) {
+        const size_t end = find_in_words(w, start, false);
+        c.values.push_back(static_cast<uint16_t>(start));
+        c.values.push_back(static_cast<uint16_t>(end - start - 1));
+        start = find_in_words(w, end, true);
+      }
+    } else if (c.cardinality <= ARRAY_LIMIT) {
+      c.type = kind::array;
+      c.values.reserve(c.cardinality);
+      for (size_t i = 0; i < WORD_COUNT; i++) {
+        for (uint64_t x = w[i]; x != 0;) {
+          const unsigned j = first_in_word(x);
+          c.values.push_back(static_cast<uint16_t>(i * 64 + j));
+          x &= ~word_mask(j);
+        }
+      }
+    } else {
+      c.type = kind::bitmap;
+      c.words.assign(w, w + WORD_COUNT);
+    }
+    return c;
+  }
+
+  static bit_container from_array(std::vector<uint16_t>&& values) {
+    if (values.size() <= ARRAY_LIMIT) {
+      bit_container c;
+      c.cardinality = static_cast<uint32_t>(values.size());
+      c.values = std::move(values);
+      return c;
+    }
+
+    words_type w{};
+    for (uint16_t v : values) w[v / 64] |= word_mask(v % 64);
+    return from_words(w.data());
+  }
+
+  template <bitwise_op OP>
+  static bit_container apply(const bit_container& a, const bit_container& b) {
+    if ((a.type == kind::array) && (b.type == kind::array)) {
+      return from_array(merge<OP>(a.values, b.values));
+    }
+
+    if (OP == bitwise_op::bit_and) {
+      // an array only needs a lookup per position
+      if ((a.type == kind::array) || (b.type == kind::array)) {
+        const bit_container& x = a.type == kind::array ? a : b;
+        const bit_container& y = a.type == kind::array ? b : a;
+        std::vector<uint16_t> v;
+        for (uint16_t p : x.values) {
+          if (y.test(p)) v.push_back(p);
+        }
+        return from_array(std::move(v));
+      }
+    }
+
+    if ((OP != bitwise_op::bit_xor) && (a.type == kind::run) &&
+        (b.type == kind::run)) {
+      return merge_runs<OP>(a, b);
+    }
+
+    // everything else goes through words
+    words_type wa;
+    words_type wb;
+    a.to_words(wa.data());
+    b.to_words(wb.data());
+    bitwise<OP>(reinterpret_cast<unsigned char*>(wa.data()),
+                reinterpret_cast<const unsigned char*>(wb.data()),
+                sizeof(words_type));
+    return from_words(wa.data());
+  }
+
+  template <bitwise_op OP>
+  static std::vector<uint16_t> merge(const std::vector<uint16_t>& a,
+                                     const std::vector<uint16_t>& b) {
+    std::vector<uint16_t> v;
+    switch (OP) {
+      case bitwise_op::bit_and:
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::back_inserter(v));
+        break;
+      case bitwise_op::bit_or:
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                       std::back_inserter(v));
+        break;
+      default:
+        std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(),
+                                      std::back_inserter(v));
+        break;
+    }
+    return v;
+  }
+
+  // intersection or union of two run containers
+  template <bitwise_op OP>
+  static bit_container merge_runs(const bit_container& a,
+                                  const bit_container& b) {
+    bit_container c;
+    c.type = kind::run;
+    size_t i = 0;
+    size_t j = 0;
+    const auto push = [&c](uint32_t start, uint32_t last) {
+      const size_t n = c.values.size();
+      if ((n != 0) && (uint32_t(c.values[n - 2]) + c.values[n - 1] + 1 >=
+                       start)) {
+        const uint32_t end = std::max<uint32_t>(
+            uint32_t(c.values[n - 2]) + c.values[n - 1], last);
+        c.values[n - 1] = static_cast<uint16_t>(end - c.values[n - 2]);
+      } else {
+        c.values.push_back(static_cast<uint16_t>(start));
+        c.values.push_back(static_cast<uint16_t>(last - start));
+      }
+    };
+
+    while ((i < a.run_count()) && (j < b.run_count())) {
+      const uint32_t as = a.values[2 * i];
+      const uint32_t al = as + a.values[2 * i + 1];
+      const uint32_t bs = b.values[2 * j];
+      const uint32_t bl = bs + b.values[2 * j + 1];
+      if (OP == bitwise_op::bit_and) {
+        if (std::max(as, bs) <= std::min(al, bl)) {
+          push(std::max(as, bs), std::min(al, bl));
+        }
+        if (al < bl) {
+          i++;
+        } else {
+          j++;
+        }
+      } else if (as <= bs) {
+        push(as, al);
+        i++;
+      } else {
+        push(bs, bl);
+        j++;
+      }
+    }
+
+    if (OP == bitwise_op::bit_or) {
+      for (; i < a.run_count(); i++) {
+        push(a.values[2 * i], uint32_t(a.values[2 * i]) + a.values[2 * i + 1]);
+      }
+      for (; j < b.run_count(); j++) {
+        push(b.values[2 * j], uint32_t(b.values[2 * j]) + b.values[2 * j + 1]);
+      }
+    }
+
+    for (size_t r = 0; r < c.run_count(); r++) {
+      c.cardinality += c.values[2 * r + 1] + 1u;
+    }
+
+    // fall back when runs are no longer the smallest form
+    if (c.run_count() * 4 >=
+        std::min<size_t>(2 * c.cardinality, 8 * WORD_COUNT)) {
+      words_type w;
+      c.to_words(w.data());
+      return from_words(w.data());
+    }
+    return c;
+  }
+};
+}  // namespace detail
+
+/**
+ * @brief Compressed bits in the style of Roaring bitmaps.
+ *
+ * The bits are cut into chunks of 65536, and every chunk holding a one is
+ * kept as a sorted array of positions, a list of runs or 1024 words,
+ * whichever is smallest. Sparse and run heavy bits take a fraction of the
+ * memory of a bit, and &, |, ^, count and rank1 work on the chunks without
+ * decompressing them. Positions are the same as in bit<BUFFER_ELEMENT_TYPE,
+ * MSB_TO_LSB>, to_bit() gives back the same buffer.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class compressed_bit {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef size_t size_type;
+  typedef bit_view<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, void> view_type;
+  typedef detail::bit_container<MSB_TO_LSB> container_type;
+
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_t CHUNK_BIT_SIZE = container_type::BIT_SIZE;
+
+ public:
+  // constructor
+  compressed_bit() = default;
+  explicit compressed_bit(const view_type& x);
+
+  // capacity
+  size_type size() const noexcept;
+  bool empty() const noexcept;
+
+  // bytes held by the chunks, for comparing with a bit
+  size_type buffer_byte_size() const noexcept;
+
+  // element access
+  bool test(size_type n) const;
+
+  // counting
+  size_type count() const noexcept;
+  bool any() const noexcept;
+  bool none() const noexcept;
+
+  // ones in [0, n), the same as bit::rank1
+  size_type rank1(size_type n) const;
+
+  // bitwise operations, both sides must have the same size
+  compressed_bit& operator&=(const compressed_bit& x);
+  compressed_bit& operator|=(const compressed_bit& x);
+  compressed_bit& operator^=(const compressed_bit& x);
+
+  // f(position) for every one in order
+  template <class FUNCTION>
+  void for_each_set_bit(FUNCTION f) const;
+
+  // decompress
+  template <class ALLOCATOR = std::allocator<BUFFER_ELEMENT_TYPE>>
+  bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR> to_bit(
+      const ALLOCATOR& allocator = ALLOCATOR()) const;
+
+ private:
+  template <detail::bitwise_op OP>
+  inline void apply(const compressed_bit& x);
+  inline void build_rank();
+
+ private:
+  size_type size_ = 0;
+  std::vector<uint64_t> keys_;  // chunk numbers in order
+  std::vector<container_type> containers_;
+  std::vector<size_type> ranks_;  // ones before each chunk, and in total
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::compressed_bit(
+    const view_type& x)
+    : size_(x.size()) {
+  typename container_type::words_type words;
+  for (size_type base = 0; base < size_; base += CHUNK_BIT_SIZE) {
+    // whole zero chunks of an aligned view are skipped a vector at a time
+    if ((x.offset() == 0) && (size_ - base >= CHUNK_BIT_SIZE) &&
+        !detail::any(reinterpret_cast<const unsigned char*>(
+                         x.data() + base / T_BIT_SIZE),
+                     CHUNK_BIT_SIZE / 8)) {
+      continue;
+    }
+
+    // read the chunk as 64-bit fields, a short last field is left aligned
+    bool any = false;
+    for (size_type i = 0; i < container_type::WORD_COUNT; i++) {
+      const size_type position = base + 64 * i;
+      uint64_t w = 0;
+      if (position < size_) {
+        const unsigned k =
+            static_cast<unsigned>(std::min<size_type>(64, size_ - position));
+        w = x.bits(position, k);
+        if (MSB_TO_LSB && (k < 64)) {
+          w <<= 64 - k;
+        }
+      }
+      words[i] = w;
+      any = any || (w != 0);
+    }
+
+    if (any) {
+      keys_.push_back(base / CHUNK_BIT_SIZE);
+      containers_.push_back(container_type::from_words(words.data()));
+    }
+  }
+
+  build_rank();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() const
+    noexcept {
+  return size_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::empty() const
+    noexcept {
+  return size_ == 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+               TYPE_CHECK>::buffer_byte_size() const noexcept {
+  size_type n = keys_.size() * (sizeof(uint64_t) + sizeof(container_type));
+  for (const container_type& c : containers_) n += c.byte_size();
+  return n;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::test(
+    size_type n) const {
+  if (n >= size_) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  const auto key =
+      std::lower_bound(keys_.begin(), keys_.end(), n / CHUNK_BIT_SIZE);
+  if ((key == keys_.end()) || (*key != n / CHUNK_BIT_SIZE)) {
+    return false;
+  }
+
+  return containers_[static_cast<size_type>(key - keys_.begin())].test(
+      static_cast<uint32_t>(n % CHUNK_BIT_SIZE));
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::count() const
+    noexcept {
+  return ranks_.empty() ? 0 : ranks_.back();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::any() const
+    noexcept {
+  return !keys_.empty();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::none() const
+    noexcept {
+  return keys_.empty();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::rank1(
+    size_type n) const {
+  if (n > size_) {
+    throw std::out_of_range("rank position is out of range.");
+  }
+
+  const size_type i = static_cast<size_type>(
+      std::lower_bound(keys_.begin(), keys_.end(), n / CHUNK_BIT_SIZE) -
+      keys_.begin());
+  size_type r = ranks_.empty() ? 0 : ranks_[i];
+  if ((i < keys_.size()) && (keys_[i] == n / CHUNK_BIT_SIZE)) {
+    r += containers_[i].rank(static_cast<uint32_t>(n % CHUNK_BIT_SIZE));
+  }
+  return r;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator&=(
+    const compressed_bit& x) {
+  apply<detail::bitwise_op::bit_and>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator|=(
+    const compressed_bit& x) {
+  apply<detail::bitwise_op::bit_or>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator^=(
+    const compressed_bit& x) {
+  apply<detail::bitwise_op::bit_xor>(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+template <class FUNCTION>
+void compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                    TYPE_CHECK>::for_each_set_bit(FUNCTION f) const {
+  for (size_type i = 0; i < keys_.size(); i++) {
+    const size_type base = keys_[i] * CHUNK_BIT_SIZE;
+    containers_[i].for_each([&](uint32_t low) { f(base + low); });
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+template <class ALLOCATOR>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::to_bit(
+    const ALLOCATOR& allocator) const {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.resize(size_);
+  BIT_CONTAINER_TYPE* data = result.data();
+
+  typename container_type::words_type words;
+  for (size_type c = 0; c < keys_.size(); c++) {
+    containers_[c].to_words(words.data());
+    const size_type base = keys_[c] * CHUNK_BIT_SIZE;
+    for (size_type i = 0; i < container_type::WORD_COUNT; i++) {
+      if (words[i] == 0) {
+        continue;
+      }
+
+      // a word is a field of up to 64 bits, stored an element at a time
+      const size_type position = base + 64 * i;
+      const size_type n = std::min<size_type>(64, size_ - position);
+      const uint64_t field = MSB_TO_LSB ? words[i] >> (64 - n)
+                                        : words[i] & range::low_mask(n);
+      for (size_type done = 0; done < n; done += T_BIT_SIZE) {
+        const size_type k = std::min<size_type>(n - done, T_BIT_SIZE);
+        const uint64_t piece =
+            MSB_TO_LSB ? field >> (n - done - k) : field >> done;
+        range::deposit(data, position + done, k,
+                       static_cast<BIT_CONTAINER_TYPE>(
+                           piece & range::low_mask(k)));
+      }
+    }
+  }
+
+  return result;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+template <detail::bitwise_op OP>
+void compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::apply(
+    const compressed_bit& x) {
+  if (size_ != x.size_) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
+
+  // merge the chunk lists, a chunk missing on one side is all zeros
+  std::vector<uint64_t> keys;
+  std::vector<container_type> containers;
+  size_type i = 0;
+  size_type j = 0;
+  while ((i < keys_.size()) || (j < x.keys_.size())) {
+    const bool left =
+        (j == x.keys_.size()) || ((i < keys_.size()) && keys_[i] < x.keys_[j]);
+    const bool right =
+        (i == keys_.size()) || ((j < x.keys_.size()) && x.keys_[j] < keys_[i]);
+
+    if (left || right) {
+      // separate push_backs, a conditional would copy the moved chunk
+      if (OP != detail::bitwise_op::bit_and) {
+        if (left) {
+          keys.push_back(keys_[i]);
+          containers.push_back(std::move(containers_[i]));
+        } else {
+          keys.push_back(x.keys_[j]);
+          containers.push_back(x.containers_[j]);
+        }
+      }
+      if (left) {
+        i++;
+      } else {
+        j++;
+      }
+      continue;
+    }
+
+    container_type c = container_type::template apply<OP>(containers_[i],
+                                                          x.containers_[j]);
+    if (c.cardinality != 0) {
+      keys.push_back(keys_[i]);
+      containers.push_back(std::move(c));
+    }
+    i++;
+    j++;
+  }
+
+  keys_.swap(keys);
+  containers_.swap(containers);
+  build_rank();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::build_rank() {
+  ranks_.assign(1, 0);
+  ranks_.reserve(containers_.size() + 1);
+  for (const container_type& c : containers_) {
+    ranks_.push_back(ranks_.back() + c.cardinality);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator&(
+    compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> lhs,
+    const compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  return lhs &= rhs;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator|(
+    compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> lhs,
+    const compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  return lhs |= rhs;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator^(
+    compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> lhs,
+    const compressed_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& rhs) {
+  return lhs ^= rhs;
+}
+}  // namespace jcy
+
+#endif  // COMPRESSED_BIT_HPP_
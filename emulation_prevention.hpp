@@ -0,0 +1,315 @@
+/**
+ * @file emulation_prevention.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef EMULATION_PREVENTION_HPP_
+#define EMULATION_PREVENTION_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+constexpr size_t ESCAPE_BLOCK_SIZE = 16;
+
+/**
+ * @brief True if some j in [0, 16) may have two zero bytes before it and
+ * p[j] equal to value (EXACT) or not above it, with zeros the number of
+ * zero bytes (up to two) just before p.
+ *
+ * Every start code and every byte that needs (or is) an emulation
+ * prevention byte is a hit, so a block without one is copied or skipped
+ * whole. Only p[0] to p[15] are read, so dst may overwrite the bytes
+ * before p.
+ */
+template <bool EXACT>
+inline bool escape_candidate(const unsigned char* p, unsigned char value,
+                             size_t zeros) noexcept {
+  const auto matches = [value](unsigned char b) {
+    return EXACT ? b == value : b <= value;
+  };
+  if (((zeros >= 2) && matches(p[0])) ||
+      ((zeros >= 1) && (p[0] == 0) && matches(p[1]))) {
+    return true;
+  }
+
+#if defined(__SSE2__)
+  const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+  const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  const __m128i z = _mm_cmpeq_epi8(c, _mm_setzero_si128());
+  const __m128i last = EXACT ? _mm_cmpeq_epi8(c, v)
+                             : _mm_cmpeq_epi8(_mm_min_epu8(c, v), c);
+  const __m128i hit = _mm_and_si128(
+      _mm_and_si128(_mm_slli_si128(z, 1), _mm_slli_si128(z, 2)), last);
+  return _mm_movemask_epi8(hit) != 0;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t none = vdupq_n_u8(0);
+  const uint8x16_t c = vld1q_u8(p);
+  const uint8x16_t z = vceqzq_u8(c);
+  const uint8x16_t last = EXACT ? vceqq_u8(c, vdupq_n_u8(value))
+                                : vcleq_u8(c, vdupq_n_u8(value));
+  const uint8x16_t hit = vandq_u8(
+      vandq_u8(vextq_u8(none, z, 15), vextq_u8(none, z, 14)), last);
+  return vmaxvq_u8(hit) != 0;
+#else
+  // a hit needs a zero byte, test 8 bytes at a time first
+  uint64_t word[2];
+  std::memcpy(word, p, 16);
+  const uint64_t low = 0x0101010101010101ull;
+  const uint64_t high = 0x8080808080808080ull;
+  if ((((word[0] - low) & ~word[0]) | ((word[1] - low) & ~word[1])) & high) {
+    for (size_t j = 2; j < ESCAPE_BLOCK_SIZE; j++) {
+      if ((p[j - 2] == 0) && (p[j - 1] == 0) && matches(p[j])) {
+        return true;
+      }
+    }
+  }
+  return false;
+#endif
+}
+
+// zero bytes at the end of a block, up to the two an escape looks at
+inline size_t trailing_zeros(const unsigned char* end) noexcept {
+  return end[-1] != 0 ? 0 : (end[-2] != 0 ? 1 : 2);
+}
+}  // namespace detail
+
+/**
+ * @brief Escaped positions of de-escaped bytes, as built by
+ * remove_emulation_prevention().
+ */
+class emulation_prevention_map {
+ public:
+  // number of emulation prevention bytes removed
+  size_t size() const noexcept;
+  bool empty() const noexcept;
+  void clear() noexcept;
+
+  // position in the escaped stream of de-escaped byte (or bit) position
+  size_t escaped_position(size_t position) const noexcept;
+  size_t escaped_bit_position(size_t position) const noexcept;
+
+ private:
+  friend size_t remove_emulation_prevention(const unsigned char* src,
+                                            size_t n, unsigned char* dst,
+                                            emulation_prevention_map* map);
+
+ private:
+  // de-escaped position of the byte after each removed byte, ascending
+  std::vector<size_t> removed_;
+};
+
+inline size_t emulation_prevention_map::size() const noexcept {
+  return removed_.size();
+}
+
+inline bool emulation_prevention_map::empty() const noexcept {
+  return removed_.empty();
+}
+
+inline void emulation_prevention_map::clear() noexcept { removed_.clear(); }
+
+inline size_t emulation_prevention_map::escaped_position(
+    size_t position) const noexcept {
+  return position + static_cast<size_t>(
+                        std::upper_bound(removed_.begin(), removed_.end(),
+                                         position) -
+                        removed_.begin());
+}
+
+inline size_t emulation_prevention_map::escaped_bit_position(
+    size_t position) const noexcept {
+  return 8 * escaped_position(position / 8) + position % 8;
+}
+
+/**
+ * @brief Position of the first 0x000001 start code prefix at or after
+ * from in n bytes, or size_t(-1).
+ *
+ * The position is that of the first zero byte, a four byte start code is
+ * found one byte in.
+ */
+inline size_t find_start_code(const unsigned char* data, size_t n,
+                              size_t from = 0) noexcept {
+  size_t i = from;
+  size_t zeros = 0;
+  for (; i + detail::ESCAPE_BLOCK_SIZE <= n; i += detail::ESCAPE_BLOCK_SIZE) {
+    if (detail::escape_candidate<true>(data + i, 1, zeros)) {
+      break;
+    }
+    zeros = detail::trailing_zeros(data + i + detail::ESCAPE_BLOCK_SIZE);
+  }
+
+  // a hit may start in the two bytes before the block
+  for (i -= zeros; i + 2 < n; i++) {
+    if ((data[i] == 0) && (data[i + 1] == 0) && (data[i + 2] == 1)) {
+      return i;
+    }
+  }
+
+  return static_cast<size_t>(-1);
+}
+
+/**
+ * @brief Bytes insert_emulation_prevention() writes at most for n bytes.
+ */
+constexpr size_t max_escaped_size(size_t n) noexcept { return n + n / 2 + 1; }
+
+/**
+ * @brief Write n payload bytes to dst with an emulation prevention byte
+ * 0x03 after every two zero bytes that are followed by a byte up to 0x03
+ * or end the payload. dst holds max_escaped_size(n) bytes and
+ * must not overlap src. Returns the bytes written.
+ *
+ * H.264 7.4.2.10 and HEVC 7.4.3.12 append the final 0x03 whenever the last
+ * byte is 0x00. A conforming RBSP only ends in 0x00 with a cabac_zero_word
+ * (0x0000), where both rules agree. On a payload ending in one zero byte a
+ * decoder keeps the 0x03 as data, since it only drops one after two zeros,
+ * so the rule here is narrower and every payload round trips.
+ */
+inline size_t insert_emulation_prevention(const unsigned char* src, size_t n,
+                                          unsigned char* dst) noexcept {
+  size_t zeros = 0;
+  size_t out = 0;
+  size_t i = 0;
+
+  const auto step = [&](unsigned char b) {
+    if ((zeros >= 2) && (b <= 3)) {
+      dst[out++] = 3;
+      zeros = 0;
+    }
+    dst[out++] = b;
+    zeros = b == 0 ? zeros + 1 : 0;
+  };
+
+  while (i + detail::ESCAPE_BLOCK_SIZE <= n) {
+    if (!detail::escape_candidate<false>(src + i, 3, zeros)) {
+      std::memcpy(dst + out, src + i, detail::ESCAPE_BLOCK_SIZE);
+      out += detail::ESCAPE_BLOCK_SIZE;
+      i += detail::ESCAPE_BLOCK_SIZE;
+      zeros = detail::trailing_zeros(src + i);
+      continue;
+    }
+
+    for (const size_t end = i + detail::ESCAPE_BLOCK_SIZE; i < end; i++) {
+      step(src[i]);
+    }
+  }
+
+  for (; i < n; i++) step(src[i]);
+
+  // a payload ending in two zero bytes, as after cabac_zero_words, keeps
+  // the next start code apart, see above for why a single zero does not
+  if (zeros >= 2) {
+    dst[out++] = 3;
+  }
+
+  return out;
+}
+
+/**
+ * @brief Write n escaped bytes to dst without the emulation prevention
+ * bytes, a 0x03 after two zero bytes. dst holds n bytes and may be src.
+ * Returns the bytes written. When map is given the removed bytes are
+ * added to it, positions are counted from src and dst.
+ */
+inline size_t remove_emulation_prevention(
+    const unsigned char* src, size_t n, unsigned char* dst,
+    emulation_prevention_map* map = nullptr) {
+  size_t zeros = 0;
+  size_t out = 0;
+  size_t i = 0;
+
+  const auto step = [&](unsigned char b) {
+    if ((zeros >= 2) && (b == 3)) {
+      zeros = 0;
+      if (map != nullptr) {
+        map->removed_.push_back(out);
+      }
+      return;
+    }
+    dst[out++] = b;
+    zeros = b == 0 ? zeros + 1 : 0;
+  };
+
+  while (i + detail::ESCAPE_BLOCK_SIZE <= n) {
+    if (!detail::escape_candidate<true>(src + i, 3, zeros)) {
+      // read before the move, which may overwrite the block in place
+      zeros = detail::trailing_zeros(src + i + detail::ESCAPE_BLOCK_SIZE);
+      std::memmove(dst + out, src + i, detail::ESCAPE_BLOCK_SIZE);
+      out += detail::ESCAPE_BLOCK_SIZE;
+      i += detail::ESCAPE_BLOCK_SIZE;
+      continue;
+    }
+
+    for (const size_t end = i + detail::ESCAPE_BLOCK_SIZE; i < end; i++) {
+      step(src[i]);
+    }
+  }
+
+  for (; i < n; i++) step(src[i]);
+
+  return out;
+}
+
+/**
+ * @brief The same operations on a bit of whole bytes, written with
+ * push_byte()/push_bytes(). Positions are in bits.
+ */
+template <class ALLOCATOR>
+size_t find_start_code(const bit<unsigned char, true, ALLOCATOR>& x,
+                       size_t from = 0) {
+  if ((x.size() % 8 != 0) || (from % 8 != 0)) {
+    throw std::invalid_argument("bit range is not byte aligned.");
+  }
+
+  const size_t found =
+      find_start_code(x.data(), x.buffer_element_count(), from / 8);
+  return found == static_cast<size_t>(-1) ? found : 8 * found;
+}
+
+template <class ALLOCATOR>
+bit<unsigned char, true, ALLOCATOR> insert_emulation_prevention(
+    const bit<unsigned char, true, ALLOCATOR>& x) {
+  if (x.size() % 8 != 0) {
+    throw std::invalid_argument("bit range is not byte aligned.");
+  }
+
+  const size_t n = x.buffer_element_count();
+  bit<unsigned char, true, ALLOCATOR> result(x.get_allocator());
+  result.resize(8 * max_escaped_size(n));
+  result.resize(8 * insert_emulation_prevention(x.data(), n, result.data()));
+  return result;
+}
+
+template <class ALLOCATOR>
+bit<unsigned char, true, ALLOCATOR> remove_emulation_prevention(
+    const bit<unsigned char, true, ALLOCATOR>& x,
+    emulation_prevention_map* map = nullptr) {
+  if (x.size() % 8 != 0) {
+    throw std::invalid_argument("bit range is not byte aligned.");
+  }
+
+  const size_t n = x.buffer_element_count();
+  bit<unsigned char, true, ALLOCATOR> result(x.get_allocator());
+  result.resize(8 * n);
+  result.resize(8 * remove_emulation_prevention(x.data(), n, result.data(),
+                                                 map));
+  return result;
+}
+}  // namespace jcy
+
+#endif  // EMULATION_PREVENTION_HPP_
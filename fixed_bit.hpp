@@ -0,0 +1,703 @@
+/**
+ * @file fixed_bit.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef FIXED_BIT_HPP_
+#define FIXED_BIT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+// constant expression versions of countl_zero/countr_zero/popcount
+constexpr unsigned constexpr_popcount(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ull);
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return static_cast<unsigned>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// x must not be zero
+constexpr unsigned constexpr_countl_zero(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_clzll(x));
+#else
+  unsigned n = 0;
+  while ((x & (uint64_t(1) << 63)) == 0) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// x must not be zero
+constexpr unsigned constexpr_countr_zero(uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+  unsigned n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+}  // namespace detail
+
+/**
+ * @brief N bits with the length fixed at compile time.
+ *
+ * The bits live in a std::array laid out exactly like the buffer of
+ * bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB>, with the padding bits kept zero. It
+ * never allocates, every loop runs over a compile time element count and
+ * all operations are constexpr, so a header template can be built with
+ * replace_bits() at compile time and appended to a bit with to_bit().
+ */
+template <size_t N, class BUFFER_ELEMENT_TYPE = unsigned char,
+          bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class fixed_bit {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef BUFFER_ELEMENT_TYPE const_reference;
+  typedef size_t size_type;
+  typedef bit_view<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, void> view_type;
+
+  static constexpr value_type ONE = value_type(1);
+  static constexpr value_type ZERO = value_type(0);
+  static constexpr value_type VALUE_MAX =
+      std::numeric_limits<value_type>::max();
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_t ELEMENT_COUNT = (N + T_BIT_SIZE - 1) / T_BIT_SIZE;
+  static constexpr size_type npos = static_cast<size_type>(-1);
+
+  // element loops up to this count are unrolled at compile time
+  static constexpr size_t UNROLL_ELEMENT_COUNT = 64;
+
+  typedef std::array<value_type, ELEMENT_COUNT> container_type;
+
+ public:
+  // constructor
+  constexpr fixed_bit() noexcept;
+  constexpr fixed_bit(std::initializer_list<value_type> il);
+
+  // reads buffer_element_count() elements, padding bits are ignored
+  constexpr explicit fixed_bit(const value_type* data) noexcept;
+
+  // capacity
+  static constexpr size_type size() noexcept;
+  static constexpr size_type buffer_element_count() noexcept;
+  static constexpr bool empty() noexcept;
+
+  // element access
+  constexpr value_type operator[](size_type n) const noexcept;
+  constexpr value_type at(size_type n) const;
+  constexpr value_type front() const noexcept;
+  constexpr value_type back() const noexcept;
+  constexpr const value_type* data() const noexcept;
+  constexpr value_type* data() noexcept;
+
+  /**
+   * @brief Read n bits (0 to 64) from position as one push_bits() field.
+   */
+  constexpr uint64_t bits(size_type position, unsigned n) const;
+
+  // view of all bits, invalidated when this is destroyed
+  view_type view() const noexcept;
+
+  // bitwise operations
+  constexpr fixed_bit& operator&=(const fixed_bit& x) noexcept;
+  constexpr fixed_bit& operator|=(const fixed_bit& x) noexcept;
+  constexpr fixed_bit& operator^=(const fixed_bit& x) noexcept;
+  constexpr fixed_bit& andnot(const fixed_bit& x) noexcept;
+  constexpr fixed_bit& flip() noexcept;
+  constexpr fixed_bit operator~() const noexcept;
+  constexpr size_type count() const noexcept;
+  constexpr bool any() const noexcept;
+  constexpr bool none() const noexcept;
+  constexpr bool all() const noexcept;
+
+  // search, the same as bit
+  constexpr size_type find_first() const noexcept;
+  constexpr size_type find_next(size_type pos) const noexcept;
+  constexpr size_type find_last() const noexcept;
+  constexpr size_type find_first_zero() const noexcept;
+  constexpr size_type find_next_zero(size_type pos) const noexcept;
+  constexpr size_type find_last_zero() const noexcept;
+
+  // modifiers
+  constexpr void replace(size_type position, value_type value);
+
+  /**
+   * @brief Overwrite nbits (0 to 64) from position with the low nbits of
+   * value, laid out as push_bits() would push them.
+   */
+  constexpr void replace_bits(size_type position, uint64_t value,
+                              unsigned nbits);
+  constexpr void clear() noexcept;
+
+  // copy into a dynamic bit
+  template <class ALLOCATOR = std::allocator<BUFFER_ELEMENT_TYPE>>
+  bit<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, ALLOCATOR> to_bit(
+      const ALLOCATOR& allocator = ALLOCATOR()) const;
+
+ private:
+  template <class FUNCTION>
+  static constexpr void for_each_element(FUNCTION f);
+  template <class FUNCTION, size_t... e>
+  static constexpr void for_each_element(FUNCTION f,
+                                         std::index_sequence<e...>);
+  static constexpr value_type valid_mask(size_type e) noexcept;
+  constexpr size_type scan_forward(size_type pos, value_type flip) const
+      noexcept;
+  constexpr size_type scan_backward(value_type flip) const noexcept;
+  constexpr void clear_padding() noexcept;
+
+ private:
+  container_type buffer_;
+};
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                    TYPE_CHECK>::fixed_bit() noexcept
+    : buffer_{} {}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::fixed_bit(
+    std::initializer_list<value_type> il)
+    : buffer_{} {
+  if (il.size() > N) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
+
+  size_type i = 0;
+  for (auto& value : il) {
+    replace(i, value);
+    i++;
+  }
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::fixed_bit(
+    const value_type* data) noexcept
+    : buffer_{} {
+  for_each_element([&](size_type e) { buffer_[e] = data[e]; });
+  clear_padding();
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() noexcept {
+  return N;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+          TYPE_CHECK>::buffer_element_count() noexcept {
+  return ELEMENT_COUNT;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::empty() noexcept {
+  return N == 0;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type
+    fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator[](
+        size_type n) const noexcept {
+  const size_type shift =
+      MSB_TO_LSB ? (T_BIT_SIZE - 1) - n % T_BIT_SIZE : n % T_BIT_SIZE;
+  return static_cast<value_type>((buffer_[n / T_BIT_SIZE] >> shift) & ONE);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::at(
+    size_type n) const {
+  if (n >= N) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  return operator[](n);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::front() const
+    noexcept {
+  return operator[](0);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::back() const
+    noexcept {
+  return operator[](N - 1);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr const typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                                   TYPE_CHECK>::value_type*
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() const
+    noexcept {
+  return buffer_.data();
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type*
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() noexcept {
+  return buffer_.data();
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr uint64_t fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::bits(size_type position,
+                                               unsigned n) const {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  if (n > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  if ((position > N) || (n > N - position)) {
+    throw std::out_of_range("bit read is out of range.");
+  }
+
+  // gather the field an element (at most) at a time
+  uint64_t value = 0;
+  size_type done = 0;
+  while (done < n) {
+    const size_type k = std::min<size_type>(n - done, T_BIT_SIZE);
+    const uint64_t field = range::extract(buffer_.data(), position + done, k);
+    if (MSB_TO_LSB) {
+      value = k == 64 ? field : (value << k) | field;
+    } else {
+      value |= field << done;
+    }
+    done += k;
+  }
+
+  return value;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::view_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::view() const
+    noexcept {
+  return view_type(buffer_.data(), 0, N);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator&=(
+    const fixed_bit& x) noexcept {
+  for_each_element([&](size_type e) { buffer_[e] &= x.buffer_[e]; });
+  return *this;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator|=(
+    const fixed_bit& x) noexcept {
+  for_each_element([&](size_type e) { buffer_[e] |= x.buffer_[e]; });
+  return *this;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator^=(
+    const fixed_bit& x) noexcept {
+  for_each_element([&](size_type e) { buffer_[e] ^= x.buffer_[e]; });
+  return *this;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::andnot(
+    const fixed_bit& x) noexcept {
+  for_each_element([&](size_type e) {
+    buffer_[e] &= static_cast<value_type>(~x.buffer_[e]);
+  });
+  return *this;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::flip() noexcept {
+  for_each_element([&](size_type e) {
+    buffer_[e] = static_cast<value_type>(~buffer_[e]);
+  });
+  clear_padding();
+  return *this;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>
+    fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator~() const
+    noexcept {
+  fixed_bit result(*this);
+  result.flip();
+  return result;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::count() const
+    noexcept {
+  size_type n = 0;
+  for_each_element(
+      [&](size_type e) { n += detail::constexpr_popcount(buffer_[e]); });
+  return n;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::any()
+    const noexcept {
+  value_type x = ZERO;
+  for_each_element([&](size_type e) { x |= buffer_[e]; });
+  return x != ZERO;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::none()
+    const noexcept {
+  return !any();
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::all()
+    const noexcept {
+  value_type x = VALUE_MAX;
+  for_each_element([&](size_type e) {
+    x &= static_cast<value_type>(buffer_[e] | ~valid_mask(e));
+  });
+  return x == VALUE_MAX;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_first() const
+    noexcept {
+  return scan_forward(0, ZERO);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_next(
+    size_type pos) const noexcept {
+  return pos >= N ? npos : scan_forward(pos + 1, ZERO);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_last() const
+    noexcept {
+  return scan_backward(ZERO);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_first_zero()
+    const noexcept {
+  return scan_forward(0, VALUE_MAX);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_next_zero(
+    size_type pos) const noexcept {
+  return pos >= N ? npos : scan_forward(pos + 1, VALUE_MAX);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::find_last_zero()
+    const noexcept {
+  return scan_backward(VALUE_MAX);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr void
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::replace(
+    size_type position, value_type value) {
+  if ((value != ZERO) && (value != ONE)) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  if (position >= N) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  const size_type shift = MSB_TO_LSB ? (T_BIT_SIZE - 1) - position % T_BIT_SIZE
+                                     : position % T_BIT_SIZE;
+  value_type& element = buffer_[position / T_BIT_SIZE];
+  element = static_cast<value_type>((element & ~(ONE << shift)) |
+                                    (value << shift));
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr void
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::replace_bits(
+    size_type position, uint64_t value, unsigned nbits) {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  if (nbits > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  if ((position > N) || (nbits > N - position)) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  // scatter the field an element (at most) at a time
+  value &= range::low_mask(nbits);
+  size_type done = 0;
+  while (done < nbits) {
+    const size_type k = std::min<size_type>(nbits - done, T_BIT_SIZE);
+    const uint64_t field =
+        MSB_TO_LSB ? value >> (nbits - done - k) : value >> done;
+    range::deposit(buffer_.data(), position + done, k,
+                   static_cast<value_type>(field & range::low_mask(k)));
+    done += k;
+  }
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr void
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::clear() noexcept {
+  for_each_element([&](size_type e) { buffer_[e] = ZERO; });
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+template <class ALLOCATOR>
+bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR>
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::to_bit(
+    const ALLOCATOR& allocator) const {
+  bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, ALLOCATOR> result(allocator);
+  result.resize(N);
+  std::copy(buffer_.begin(), buffer_.end(), result.data());
+  return result;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+template <class FUNCTION>
+constexpr void
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::for_each_element(
+    FUNCTION f) {
+  if constexpr (ELEMENT_COUNT <= UNROLL_ELEMENT_COUNT) {
+    for_each_element(f, std::make_index_sequence<ELEMENT_COUNT>{});
+  } else {
+    for (size_type e = 0; e < ELEMENT_COUNT; e++) f(e);
+  }
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+template <class FUNCTION, size_t... e>
+constexpr void
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::for_each_element(
+    FUNCTION f, std::index_sequence<e...>) {
+  static_cast<void>(f);  // unused when there are no elements
+  (f(e), ...);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::value_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::valid_mask(
+    size_type e) noexcept {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  constexpr size_type tail = N % T_BIT_SIZE;
+  if ((tail == 0) || (e + 1 != ELEMENT_COUNT)) {
+    return VALUE_MAX;
+  }
+
+  return static_cast<value_type>(
+      MSB_TO_LSB ? ~range::low_mask(T_BIT_SIZE - tail) : range::low_mask(tail));
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::scan_forward(
+    size_type pos, value_type flip) const noexcept {
+  if (pos >= N) {
+    return npos;
+  }
+
+  // flip turns a zero search into a one search, valid_mask drops padding
+  size_type e = pos / T_BIT_SIZE;
+  const size_type o = pos % T_BIT_SIZE;
+  uint64_t x = static_cast<value_type>(buffer_[e] ^ flip) & valid_mask(e);
+  x &= MSB_TO_LSB ? (VALUE_MAX >> o) : (uint64_t(VALUE_MAX) << o);
+
+  while (true) {
+    if (x != 0) {
+      return e * T_BIT_SIZE +
+             (MSB_TO_LSB
+                  ? detail::constexpr_countl_zero(x) - (64 - T_BIT_SIZE)
+                  : detail::constexpr_countr_zero(x));
+    }
+
+    if (++e == ELEMENT_COUNT) {
+      return npos;
+    }
+    x = static_cast<value_type>(buffer_[e] ^ flip) & valid_mask(e);
+  }
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr typename fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                             TYPE_CHECK>::size_type
+fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::scan_backward(
+    value_type flip) const noexcept {
+  for (size_type e = ELEMENT_COUNT; e-- > 0;) {
+    const uint64_t x =
+        static_cast<value_type>(buffer_[e] ^ flip) & valid_mask(e);
+    if (x != 0) {
+      return e * T_BIT_SIZE +
+             (MSB_TO_LSB ? (T_BIT_SIZE - 1) - detail::constexpr_countr_zero(x)
+                         : 63 - detail::constexpr_countl_zero(x));
+    }
+  }
+
+  return npos;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr void fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                         TYPE_CHECK>::clear_padding() noexcept {
+  if (N % T_BIT_SIZE != 0) {
+    buffer_[ELEMENT_COUNT - 1] &= valid_mask(ELEMENT_COUNT - 1);
+  }
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool operator==(
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& x,
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+        y) noexcept {
+  return (x ^ y).none();
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr bool operator!=(
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>& x,
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+        y) noexcept {
+  return !(x == y);
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator&(
+    fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> x,
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+        y) noexcept {
+  return x &= y;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator|(
+    fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> x,
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+        y) noexcept {
+  return x |= y;
+}
+
+template <size_t N, class BIT_CONTAINER_TYPE, bool MSB_TO_LSB,
+          class TYPE_CHECK>
+constexpr fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> operator^(
+    fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK> x,
+    const fixed_bit<N, BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+        y) noexcept {
+  return x ^= y;
+}
+}  // namespace jcy
+
+#endif  // FIXED_BIT_HPP_
@@ -0,0 +1,515 @@
+/**
+ * @file mapped_bit.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef MAPPED_BIT_HPP_
+#define MAPPED_BIT_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "bit.hpp"
+
+namespace jcy {
+namespace detail {
+/**
+ * @brief First 64 bytes of a bit file, the elements follow it.
+ *
+ * order_mark holds 0x01020304 as written by the host, so a file is only
+ * opened by a host of the same byte order.
+ */
+struct mapped_bit_header {
+  static constexpr char MAGIC[8] = {'J', 'C', 'Y', 'B', 'I', 'T', 0, 0};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t ORDER_MARK = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t order_mark;
+  uint32_t element_size;
+  uint32_t msb_to_lsb;
+  uint64_t size;  // in bits
+  char reserved[32];
+};
+
+static_assert(sizeof(mapped_bit_header) == 64,
+              "bit file header must be 64 bytes.");
+}  // namespace detail
+
+/**
+ * @brief Bits stored in a memory mapped file.
+ *
+ * Opening only maps the file, pages are read on first touch, so startup
+ * does not depend on the file size. The elements have the layout of the
+ * bit buffer and can be used through view() with every bit_view
+ * algorithm and bit_reader. In read_write mode push(), push_bits() and
+ * append() grow the file geometrically, close() trims it to the last used
+ * element. Only one mapped_bit should have a file open for writing.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true,
+          class = typename std::enable_if<
+              std::is_unsigned<BUFFER_ELEMENT_TYPE>::value>::type>
+class mapped_bit {
+ public:
+  typedef BUFFER_ELEMENT_TYPE value_type;
+  typedef BUFFER_ELEMENT_TYPE const_reference;
+  typedef size_t size_type;
+  typedef bit_view<BUFFER_ELEMENT_TYPE, MSB_TO_LSB, void> view_type;
+
+  // read_write creates the file when it does not exist
+  enum class open_mode { read_only, read_write };
+
+  static constexpr value_type ONE = value_type(1);
+  static constexpr value_type ZERO = value_type(0);
+  static constexpr size_t T_BIT_SIZE = 8 * sizeof(value_type);
+  static constexpr size_t HEADER_SIZE = sizeof(detail::mapped_bit_header);
+
+ public:
+  // constructor
+  mapped_bit() noexcept = default;
+  mapped_bit(const std::string& path, open_mode mode);
+  mapped_bit(const mapped_bit&) = delete;
+  mapped_bit(mapped_bit&& x) noexcept;
+
+  // destructor
+  ~mapped_bit();
+
+  // assignment operator
+  mapped_bit& operator=(const mapped_bit&) = delete;
+  mapped_bit& operator=(mapped_bit&& x) noexcept;
+
+  // file
+  void open(const std::string& path, open_mode mode);
+  void close();
+  void sync();
+  bool is_open() const noexcept;
+  bool writable() const noexcept;
+
+  // capacity
+  size_type size() const noexcept;
+  bool empty() const noexcept;
+  void reserve(size_type n);
+  size_type buffer_element_count() const noexcept;
+
+  // element access
+  value_type operator[](size_type n) const noexcept;
+  value_type at(size_type n) const;
+  // read_only code takes the const overload, the other one needs read_write
+  const value_type* data() const noexcept;
+  value_type* data();
+  view_type view() const noexcept;
+  view_type sub_range(size_type begin, size_type end) const;
+
+  // modifiers, the file must be open for writing
+  void replace(size_type position, value_type value);
+  void push(value_type value);
+  void push_bits(uint64_t value, unsigned nbits);
+  mapped_bit& append(const view_type& x);
+
+ private:
+  inline void check_writable() const;
+  inline void map(size_t bytes);
+  inline void unmap() noexcept;
+  inline detail::mapped_bit_header* header() const noexcept;
+  inline value_type* elements() const noexcept;
+  inline void swap(mapped_bit& x) noexcept;
+
+ private:
+  int fd_ = -1;
+  bool writable_ = false;
+  char* map_ = nullptr;
+  size_t map_size_ = 0;  // in bytes, header included
+};
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::mapped_bit(
+    const std::string& path, open_mode mode) {
+  open(path, mode);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::mapped_bit(
+    mapped_bit&& x) noexcept {
+  swap(x);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::~mapped_bit() {
+  try {
+    close();
+  } catch (...) {
+    // the data is already in the page cache, only the trim failed
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator=(
+    mapped_bit&& x) noexcept {
+  mapped_bit closing(std::move(*this));
+  swap(x);
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::open(
+    const std::string& path, open_mode mode) {
+  close();
+
+  writable_ = mode == open_mode::read_write;
+  fd_ = ::open(path.c_str(), writable_ ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "bit file open failed.");
+  }
+
+  struct stat status;
+  if (::fstat(fd_, &status) != 0) {
+    const int error = errno;
+    close();
+    throw std::system_error(error, std::generic_category(),
+                            "bit file stat failed.");
+  }
+
+  const size_t bytes = static_cast<size_t>(status.st_size);
+  if ((bytes == 0) && writable_) {
+    // a new file gets a header and room for one page of elements
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    if (::ftruncate(fd_, static_cast<off_t>(page)) != 0) {
+      const int error = errno;
+      close();
+      throw std::system_error(error, std::generic_category(),
+                              "bit file resize failed.");
+    }
+
+    map(page);
+    detail::mapped_bit_header* h = header();
+    std::memcpy(h->magic, detail::mapped_bit_header::MAGIC, 8);
+    h->version = detail::mapped_bit_header::VERSION;
+    h->order_mark = detail::mapped_bit_header::ORDER_MARK;
+    h->element_size = sizeof(value_type);
+    h->msb_to_lsb = MSB_TO_LSB ? 1 : 0;
+    h->size = 0;
+    return;
+  }
+
+  if (bytes < HEADER_SIZE) {
+    close();
+    throw std::invalid_argument("bit file header is missing.");
+  }
+
+  map(bytes);
+  const detail::mapped_bit_header* h = header();
+  const char* error = nullptr;
+  if ((std::memcmp(h->magic, detail::mapped_bit_header::MAGIC, 8) != 0) ||
+      (h->version != detail::mapped_bit_header::VERSION) ||
+      (h->order_mark != detail::mapped_bit_header::ORDER_MARK)) {
+    error = "bit file header is not recognized.";
+  } else if (h->element_size != sizeof(value_type)) {
+    error = "bit file element type does not match.";
+  } else if (h->msb_to_lsb != (MSB_TO_LSB ? 1u : 0u)) {
+    error = "bit file bit order does not match.";
+  } else if (h->size / T_BIT_SIZE + (h->size % T_BIT_SIZE != 0) >
+             (bytes - HEADER_SIZE) / sizeof(value_type)) {
+    // the size is not trusted, round it up without overflowing
+    error = "bit file is truncated.";
+  }
+
+  if (error != nullptr) {
+    close();
+    throw std::invalid_argument(error);
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::close() {
+  if (fd_ < 0) {
+    return;
+  }
+
+  // drop the unused capacity so the file ends at the last element
+  size_t bytes = 0;
+  if (writable_ && (map_ != nullptr)) {
+    bytes = HEADER_SIZE + buffer_element_count() * sizeof(value_type);
+  }
+
+  unmap();
+  const int fd = fd_;
+  fd_ = -1;
+  writable_ = false;
+
+  const bool trimmed =
+      (bytes == 0) || (::ftruncate(fd, static_cast<off_t>(bytes)) == 0);
+  const int error = errno;
+  ::close(fd);
+
+  if (!trimmed) {
+    throw std::system_error(error, std::generic_category(),
+                            "bit file resize failed.");
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::sync() {
+  if (writable_ && (::msync(map_, map_size_, MS_SYNC) != 0)) {
+    throw std::system_error(errno, std::generic_category(),
+                            "bit file sync failed.");
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::is_open() const
+    noexcept {
+  return fd_ >= 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::writable() const
+    noexcept {
+  return writable_;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size() const noexcept {
+  return map_ == nullptr ? 0 : static_cast<size_type>(header()->size);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+bool mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::empty() const
+    noexcept {
+  return size() == 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::reserve(
+    size_type n) {
+  check_writable();
+
+  const size_t needed =
+      HEADER_SIZE + (n + T_BIT_SIZE - 1) / T_BIT_SIZE * sizeof(value_type);
+  if (needed <= map_size_) {
+    return;
+  }
+
+  // grow geometrically, the new tail reads as zeros
+  const size_t bytes = std::max(needed, 2 * map_size_);
+  unmap();
+  if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+    const int error = errno;
+    map(static_cast<size_t>(::lseek(fd_, 0, SEEK_END)));
+    throw std::system_error(error, std::generic_category(),
+                            "bit file resize failed.");
+  }
+  map(bytes);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::size_type
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+           TYPE_CHECK>::buffer_element_count() const noexcept {
+  return (size() + T_BIT_SIZE - 1) / T_BIT_SIZE;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+    mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::operator[](
+        size_type n) const noexcept {
+  const size_type shift =
+      MSB_TO_LSB ? (T_BIT_SIZE - 1) - n % T_BIT_SIZE : n % T_BIT_SIZE;
+  return static_cast<value_type>((elements()[n / T_BIT_SIZE] >> shift) & ONE);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::at(
+    size_type n) const {
+  if (n >= size()) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  return operator[](n);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+const typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB,
+                          TYPE_CHECK>::value_type*
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() const
+    noexcept {
+  return elements();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type*
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::data() {
+  check_writable();
+  return elements();
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::view_type
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::view() const
+    noexcept {
+  return view_type(elements(), 0, size());
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::view_type
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::sub_range(
+    size_type begin, size_type end) const {
+  if ((begin > end) || (end > size())) {
+    throw std::out_of_range("bit range is out of range.");
+  }
+
+  return view_type(elements(), begin, end - begin);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::replace(
+    size_type position, value_type value) {
+  check_writable();
+
+  if ((value != ZERO) && (value != ONE)) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  if (position >= size()) {
+    throw std::out_of_range("bit query position is out of range.");
+  }
+
+  const size_type shift = MSB_TO_LSB ? (T_BIT_SIZE - 1) - position % T_BIT_SIZE
+                                     : position % T_BIT_SIZE;
+  value_type& element = elements()[position / T_BIT_SIZE];
+  element = static_cast<value_type>((element & ~(ONE << shift)) |
+                                    (value << shift));
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push(
+    value_type value) {
+  if ((value != ZERO) && (value != ONE)) {
+    throw std::invalid_argument("input argument is not one or zero.");
+  }
+
+  push_bits(value, 1);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::push_bits(
+    uint64_t value, unsigned nbits) {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  if (nbits > 64) {
+    throw std::invalid_argument("bit count is larger than 64.");
+  }
+
+  const size_type position = size();
+  reserve(position + nbits);
+
+  // scatter the field an element (at most) at a time
+  value &= range::low_mask(nbits);
+  size_type done = 0;
+  while (done < nbits) {
+    const size_type k = std::min<size_type>(nbits - done, T_BIT_SIZE);
+    const uint64_t field =
+        MSB_TO_LSB ? value >> (nbits - done - k) : value >> done;
+    range::deposit(elements(), position + done, k,
+                   static_cast<value_type>(field & range::low_mask(k)));
+    done += k;
+  }
+
+  header()->size = position + nbits;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>&
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::append(
+    const view_type& x) {
+  typedef detail::bit_range<BIT_CONTAINER_TYPE, MSB_TO_LSB> range;
+
+  const size_type position = size();
+  reserve(position + x.size());
+  range::copy(elements(), position, x.data(), x.offset(), x.size());
+  header()->size = position + x.size();
+  return *this;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::check_writable()
+    const {
+  if (!writable_) {
+    throw std::invalid_argument("bit file is not open for writing.");
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::map(
+    size_t bytes) {
+  const int protection = writable_ ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* address = ::mmap(nullptr, bytes, protection, MAP_SHARED, fd_, 0);
+  if (address == MAP_FAILED) {
+    const int error = errno;
+    close();
+    throw std::system_error(error, std::generic_category(),
+                            "bit file map failed.");
+  }
+
+  map_ = static_cast<char*>(address);
+  map_size_ = bytes;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::unmap() noexcept {
+  if (map_ != nullptr) {
+    ::munmap(map_, map_size_);
+  }
+
+  map_ = nullptr;
+  map_size_ = 0;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+detail::mapped_bit_header*
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::header() const
+    noexcept {
+  return reinterpret_cast<detail::mapped_bit_header*>(map_);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+typename mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::value_type*
+mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::elements() const
+    noexcept {
+  return map_ == nullptr ? nullptr
+                         : reinterpret_cast<value_type*>(map_ + HEADER_SIZE);
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB, class TYPE_CHECK>
+void mapped_bit<BIT_CONTAINER_TYPE, MSB_TO_LSB, TYPE_CHECK>::swap(
+    mapped_bit& x) noexcept {
+  std::swap(fd_, x.fd_);
+  std::swap(writable_, x.writable_);
+  std::swap(map_, x.map_);
+  std::swap(map_size_, x.map_size_);
+}
+}  // namespace jcy
+
+#endif  // MAPPED_BIT_HPP_
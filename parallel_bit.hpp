@@ -0,0 +1,225 @@
+/**
+ * @file parallel_bit.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef PARALLEL_BIT_HPP_
+#define PARALLEL_BIT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "bit.hpp"
+#include "thread_pool.hpp"
+
+namespace jcy {
+namespace detail {
+constexpr size_t PARALLEL_MIN_BYTES = 256 * 1024;
+constexpr size_t PARALLEL_PARTS_PER_THREAD = 4;
+
+struct byte_partition {
+  size_t head;  // bytes up to the first cache line boundary
+  size_t part;  // bytes in each part but the first and the last
+  size_t count;
+
+  size_t begin(size_t i, size_t n) const noexcept {
+    return i == 0 ? 0 : std::min(n, head + (i - 1) * part);
+  }
+
+  size_t end(size_t i, size_t n) const noexcept {
+    return i + 1 == count ? n : std::min(n, head + i * part);
+  }
+};
+
+/**
+ * @brief Split n bytes from base into parts for a thread pool.
+ *
+ * Inner boundaries fall on cache line addresses, so no two parts write to
+ * the same line, and parts are at least PARALLEL_MIN_BYTES long. Since
+ * elements are at most 8 bytes, parts also hold whole elements.
+ */
+inline byte_partition partition_bytes(const void* base, size_t n,
+                                      size_t threads) noexcept {
+  const size_t address = reinterpret_cast<size_t>(base);
+  const size_t head =
+      std::min(n, (CACHE_LINE_SIZE - address % CACHE_LINE_SIZE) %
+                      CACHE_LINE_SIZE);
+  const size_t wanted =
+      std::max<size_t>(threads, 1) * PARALLEL_PARTS_PER_THREAD;
+  size_t part = std::max((n - head) / wanted, PARALLEL_MIN_BYTES);
+  part = (part + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  return byte_partition{head, part, 1 + (n - head + part - 1) / part};
+}
+
+// call f(begin, end) on byte ranges of [0, n) on the pool
+template <class FUNCTION>
+void parallel_bytes(thread_pool& pool, const void* base, size_t n,
+                    FUNCTION f) {
+  const byte_partition p = partition_bytes(base, n, pool.size());
+  pool.parallel_for(p.count, [&](size_t i) {
+    const size_t begin = p.begin(i, n);
+    const size_t end = p.end(i, n);
+    if (begin < end) {
+      f(begin, end);
+    }
+  });
+}
+
+template <bitwise_op OP, class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_apply(bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                    const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                    thread_pool& pool) {
+  if (x.size() != y.size()) {
+    throw std::invalid_argument("bit sizes do not match.");
+  }
+
+  // padding bits are zero on both sides and stay zero
+  unsigned char* dst = reinterpret_cast<unsigned char*>(x.data());
+  const unsigned char* src =
+      reinterpret_cast<const unsigned char*>(y.data());
+  const size_t n = x.buffer_element_count() * sizeof(T);
+  parallel_bytes(pool, dst, n, [&](size_t begin, size_t end) {
+    bitwise<OP>(dst + begin, src + begin, end - begin);
+  });
+}
+
+template <bool FIND_ONE, class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t parallel_find(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                     thread_pool& pool) {
+  typedef bit<T, MSB_TO_LSB, ALLOCATOR> bit_type;
+
+  // parts after the best match found so far are skipped
+  std::atomic<size_t> best(bit_type::npos);
+  const size_t bit_size = x.size();
+  const size_t n = x.buffer_element_count() * sizeof(T);
+  parallel_bytes(pool, x.data(), n, [&](size_t begin, size_t end) {
+    const size_t first = begin * 8;
+    const size_t last = std::min(end * 8, bit_size);
+    if ((first >= last) || (first >= best.load())) {
+      return;
+    }
+
+    const typename bit_type::view_type part = x.sub_range(first, last);
+    const size_t found =
+        FIND_ONE ? part.find_first() : part.find_first_zero();
+    if (found == bit_type::view_type::npos) {
+      return;
+    }
+
+    size_t current = best.load();
+    while ((first + found < current) &&
+           !best.compare_exchange_weak(current, first + found)) {
+    }
+  });
+  return best.load();
+}
+}  // namespace detail
+
+/**
+ * @brief Bulk operations split over a thread pool.
+ *
+ * The buffer is cut into cache line aligned ranges, a few per thread, and
+ * every range runs the same kernel as the serial member function. The
+ * results are the same as count(), &=, |=, ^=, andnot(), find_first(),
+ * find_first_zero() and build_rank_index().
+ */
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t parallel_count(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                      thread_pool& pool = thread_pool::global()) {
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(x.data());
+  const size_t n = x.buffer_element_count() * sizeof(T);
+  std::atomic<size_t> total(0);
+  detail::parallel_bytes(pool, bytes, n, [&](size_t begin, size_t end) {
+    total += detail::popcount(bytes + begin, end - begin);
+  });
+  return total.load();
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_and(bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                  const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                  thread_pool& pool = thread_pool::global()) {
+  detail::parallel_apply<detail::bitwise_op::bit_and>(x, y, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_or(bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                 const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                 thread_pool& pool = thread_pool::global()) {
+  detail::parallel_apply<detail::bitwise_op::bit_or>(x, y, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_xor(bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                  const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                  thread_pool& pool = thread_pool::global()) {
+  detail::parallel_apply<detail::bitwise_op::bit_xor>(x, y, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_andnot(bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                     const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                     thread_pool& pool = thread_pool::global()) {
+  detail::parallel_apply<detail::bitwise_op::bit_andnot>(x, y, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+bool parallel_equal(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                    const bit<T, MSB_TO_LSB, ALLOCATOR>& y,
+                    thread_pool& pool = thread_pool::global()) {
+  if (x.size() != y.size()) {
+    return false;
+  }
+
+  // padding bits are zero, so whole buffers compare
+  const unsigned char* a = reinterpret_cast<const unsigned char*>(x.data());
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(y.data());
+  const size_t n = x.buffer_element_count() * sizeof(T);
+  std::atomic<bool> equal(true);
+  detail::parallel_bytes(pool, a, n, [&](size_t begin, size_t end) {
+    if (equal.load() &&
+        (std::memcmp(a + begin, b + begin, end - begin) != 0)) {
+      equal = false;
+    }
+  });
+  return equal.load();
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t parallel_find_first(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                           thread_pool& pool = thread_pool::global()) {
+  return detail::parallel_find<true>(x, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+size_t parallel_find_first_zero(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                                thread_pool& pool = thread_pool::global()) {
+  return detail::parallel_find<false>(x, pool);
+}
+
+template <class T, bool MSB_TO_LSB, class ALLOCATOR>
+void parallel_build_rank_index(const bit<T, MSB_TO_LSB, ALLOCATOR>& x,
+                               thread_pool& pool = thread_pool::global()) {
+  // superblocks are 512 bytes, hand them out in PARALLEL_MIN_BYTES steps
+  const size_t step = detail::PARALLEL_MIN_BYTES / 512;
+  x.build_rank_index([&pool, step](size_t n, auto f) {
+    pool.parallel_for((n + step - 1) / step, [&](size_t i) {
+      f(i * step, std::min(n, (i + 1) * step));
+    });
+  });
+}
+}  // namespace jcy
+
+#endif  // PARALLEL_BIT_HPP_
@@ -0,0 +1,446 @@
+/**
+ * @file prefix_code.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef PREFIX_CODE_HPP_
+#define PREFIX_CODE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "bit.hpp"
+
+namespace jcy {
+/**
+ * @brief Canonical prefix (Huffman) code given by the code length of each
+ * symbol, 0 for a symbol without a code.
+ *
+ * Codes are assigned in order of length, then symbol, as in DEFLATE and
+ * JPEG. The first bit of a code is read first in either order, so for
+ * LSB_TO_MSB streams a code is stored bit reversed. Decoding looks up the
+ * next root_bits() bits in a root table. A longer code goes on through a
+ * chain of sub tables indexed by the bits after it, each of at most
+ * root_bits() bits.
+ */
+template <bool MSB_TO_LSB = true>
+class prefix_code_table {
+ public:
+  typedef size_t size_type;
+  typedef uint32_t symbol_type;
+
+  static constexpr unsigned MAX_CODE_LENGTH = 32;
+  static constexpr unsigned MAX_ROOT_BITS = 16;
+  static constexpr unsigned DEFAULT_ROOT_BITS = 10;
+  static constexpr size_type MAX_SYMBOL_COUNT = size_type(1) << 24;
+
+ public:
+  // constructor
+  prefix_code_table(const uint8_t* lengths, size_type n,
+                    unsigned root_bits = DEFAULT_ROOT_BITS);
+  explicit prefix_code_table(const std::vector<uint8_t>& lengths,
+                             unsigned root_bits = DEFAULT_ROOT_BITS);
+
+  size_type symbol_count() const noexcept;
+  unsigned max_length() const noexcept;
+  unsigned root_bits() const noexcept;
+
+  // code of symbol in the bit::push_bits() layout, length 0 if it has none
+  unsigned length(symbol_type symbol) const;
+  uint32_t code(symbol_type symbol) const;
+
+  /**
+   * @brief Append the codes of n symbols, gathered into 64-bit fields for
+   * push_bits(). A symbol without a code throws, after the codes before it
+   * are appended.
+   */
+  template <class T, class ALLOCATOR>
+  void encode(symbol_type symbol, bit<T, MSB_TO_LSB, ALLOCATOR>& out) const;
+  template <class T, class ALLOCATOR>
+  void encode_n(const symbol_type* symbols, size_type n,
+                bit<T, MSB_TO_LSB, ALLOCATOR>& out) const;
+
+ private:
+  template <class, bool>
+  friend class prefix_decoder;
+
+  // an entry is the symbol (or sub table offset) over 8 bits of flags and
+  // the code length (or sub table bits)
+  static constexpr uint32_t VALUE_SHIFT = 8;
+  static constexpr uint32_t VALID = 0x80;
+  static constexpr uint32_t LINK = 0x40;
+  static constexpr uint32_t LENGTH_MASK = 0x3F;
+
+  static inline uint32_t index(uint64_t window, unsigned consumed,
+                               unsigned bits) noexcept;
+  static inline size_type place(uint64_t value, unsigned width,
+                                uint64_t rest, unsigned rest_width) noexcept;
+  static inline uint32_t lookup(const uint32_t* entries, unsigned root_bits,
+                                uint64_t window) noexcept;
+  void fill(size_type offset, unsigned bits, unsigned consumed,
+            const std::vector<uint32_t>& codes, const symbol_type* sorted,
+            size_type n);
+
+ private:
+  std::vector<uint8_t> lengths_;
+  std::vector<uint32_t> codes_;
+  std::vector<uint32_t> entries_;
+  unsigned max_length_ = 0;
+  unsigned root_bits_ = 1;
+  // bits a lookup reads at most
+  unsigned window_bits_ = 1;
+};
+
+/**
+ * @brief Decodes symbols of a prefix_code_table from a bit_reader. The
+ * table and the reader must outlive the decoder, and the reader may be
+ * used directly between calls.
+ *
+ * Codes are looked up in the reader's 64-bit cache. decode_n() refills it
+ * once, then decodes while the cache still holds the longest code, so the
+ * inner loop is a lookup and a shift per symbol. Codes that straddle the
+ * cache and the next element go through a slower path.
+ */
+template <class BUFFER_ELEMENT_TYPE = unsigned char, bool MSB_TO_LSB = true>
+class prefix_decoder {
+ public:
+  typedef bit_reader<BUFFER_ELEMENT_TYPE, MSB_TO_LSB> reader_type;
+  typedef prefix_code_table<MSB_TO_LSB> table_type;
+  typedef typename table_type::symbol_type symbol_type;
+  typedef size_t size_type;
+
+ public:
+  // constructor
+  prefix_decoder(const table_type& table, reader_type& reader) noexcept;
+
+  symbol_type decode();
+  void decode_n(symbol_type* symbols, size_type n);
+
+ private:
+  inline symbol_type decode_straddling();
+
+ private:
+  const table_type& table_;
+  reader_type& reader_;
+};
+
+template <bool MSB_TO_LSB>
+prefix_code_table<MSB_TO_LSB>::prefix_code_table(const uint8_t* lengths,
+                                                 size_type n,
+                                                 unsigned root_bits)
+    : lengths_(lengths, lengths + n), codes_(n, 0) {
+  if ((root_bits == 0) || (root_bits > MAX_ROOT_BITS)) {
+    throw std::invalid_argument("root table bits are out of range.");
+  }
+
+  if (n > MAX_SYMBOL_COUNT) {
+    throw std::invalid_argument("symbol count is out of range.");
+  }
+
+  // codes of each length and the Kraft sum, in units of the longest code
+  size_type counts[MAX_CODE_LENGTH + 1] = {};
+  for (const uint8_t length : lengths_) {
+    if (length > MAX_CODE_LENGTH) {
+      throw std::invalid_argument("code length is larger than 32.");
+    }
+    counts[length]++;
+    max_length_ = std::max<unsigned>(max_length_, length);
+  }
+
+  uint64_t left = 1;
+  for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++) {
+    left <<= 1;
+    if (counts[length] > left) {
+      throw std::invalid_argument("code lengths are over subscribed.");
+    }
+    left -= counts[length];
+  }
+
+  // canonical codes, and the symbols in code order
+  uint64_t next[MAX_CODE_LENGTH + 1] = {};
+  size_type starts[MAX_CODE_LENGTH + 1] = {};
+  for (unsigned length = 2; length <= MAX_CODE_LENGTH; length++) {
+    next[length] = (next[length - 1] + counts[length - 1]) << 1;
+    starts[length] = starts[length - 1] + counts[length - 1];
+  }
+
+  std::vector<uint32_t> codes(n, 0);
+  std::vector<symbol_type> sorted(n - counts[0]);
+  for (size_type s = 0; s < n; s++) {
+    const unsigned length = lengths_[s];
+    if (length == 0) {
+      continue;
+    }
+
+    codes[s] = static_cast<uint32_t>(next[length]++);
+    codes_[s] = MSB_TO_LSB ? codes[s]
+                           : static_cast<uint32_t>(
+                                 detail::reverse_bits(codes[s]) >>
+                                 (64 - length));
+    sorted[starts[length]++] = static_cast<symbol_type>(s);
+  }
+
+  root_bits_ = std::min(root_bits, std::max(max_length_, 1u));
+  window_bits_ = std::max(max_length_, root_bits_);
+  entries_.assign(size_type(1) << root_bits_, 0);
+  fill(0, root_bits_, 0, codes, sorted.data(), sorted.size());
+}
+
+template <bool MSB_TO_LSB>
+prefix_code_table<MSB_TO_LSB>::prefix_code_table(
+    const std::vector<uint8_t>& lengths, unsigned root_bits)
+    : prefix_code_table(lengths.data(), lengths.size(), root_bits) {}
+
+template <bool MSB_TO_LSB>
+typename prefix_code_table<MSB_TO_LSB>::size_type
+prefix_code_table<MSB_TO_LSB>::symbol_count() const noexcept {
+  return lengths_.size();
+}
+
+template <bool MSB_TO_LSB>
+unsigned prefix_code_table<MSB_TO_LSB>::max_length() const noexcept {
+  return max_length_;
+}
+
+template <bool MSB_TO_LSB>
+unsigned prefix_code_table<MSB_TO_LSB>::root_bits() const noexcept {
+  return root_bits_;
+}
+
+template <bool MSB_TO_LSB>
+unsigned prefix_code_table<MSB_TO_LSB>::length(symbol_type symbol) const {
+  return lengths_.at(symbol);
+}
+
+template <bool MSB_TO_LSB>
+uint32_t prefix_code_table<MSB_TO_LSB>::code(symbol_type symbol) const {
+  return codes_.at(symbol);
+}
+
+template <bool MSB_TO_LSB>
+template <class T, class ALLOCATOR>
+void prefix_code_table<MSB_TO_LSB>::encode(
+    symbol_type symbol, bit<T, MSB_TO_LSB, ALLOCATOR>& out) const {
+  encode_n(&symbol, 1, out);
+}
+
+template <bool MSB_TO_LSB>
+template <class T, class ALLOCATOR>
+void prefix_code_table<MSB_TO_LSB>::encode_n(
+    const symbol_type* symbols, size_type n,
+    bit<T, MSB_TO_LSB, ALLOCATOR>& out) const {
+  uint64_t field = 0;
+  unsigned bits = 0;
+  for (size_type i = 0; i < n; i++) {
+    const symbol_type symbol = symbols[i];
+    const unsigned length = symbol < lengths_.size() ? lengths_[symbol] : 0;
+    if (length == 0) {
+      out.push_bits(field, bits);
+      throw std::invalid_argument("symbol has no prefix code.");
+    }
+
+    if (bits + length > 64) {
+      out.push_bits(field, bits);
+      field = 0;
+      bits = 0;
+    }
+
+    field = MSB_TO_LSB ? (field << length) | codes_[symbol]
+                       : field | (uint64_t(codes_[symbol]) << bits);
+    bits += length;
+  }
+
+  out.push_bits(field, bits);
+}
+
+template <bool MSB_TO_LSB>
+uint32_t prefix_code_table<MSB_TO_LSB>::index(uint64_t window,
+                                              unsigned consumed,
+                                              unsigned bits) noexcept {
+  // the next bit is the MSB (or the LSB) of the window
+  return static_cast<uint32_t>(
+      MSB_TO_LSB ? (window << consumed) >> (64 - bits)
+                 : (window >> consumed) & ((uint64_t(1) << bits) - 1));
+}
+
+template <bool MSB_TO_LSB>
+typename prefix_code_table<MSB_TO_LSB>::size_type
+prefix_code_table<MSB_TO_LSB>::place(uint64_t value, unsigned width,
+                                     uint64_t rest,
+                                     unsigned rest_width) noexcept {
+  // value is width bits first bit first, rest the bits that come after it
+  if (MSB_TO_LSB) {
+    return static_cast<size_type>((value << rest_width) | rest);
+  }
+
+  return static_cast<size_type>(
+      (detail::reverse_bits(value) >> (64 - width)) | (rest << width));
+}
+
+template <bool MSB_TO_LSB>
+uint32_t prefix_code_table<MSB_TO_LSB>::lookup(const uint32_t* entries,
+                                               unsigned root_bits,
+                                               uint64_t window) noexcept {
+  uint32_t entry = entries[index(window, 0, root_bits)];
+  unsigned consumed = root_bits;
+  while ((entry & LINK) != 0) {
+    const unsigned bits = entry & LENGTH_MASK;
+    entry = entries[(entry >> VALUE_SHIFT) + index(window, consumed, bits)];
+    consumed += bits;
+  }
+  return entry;
+}
+
+template <bool MSB_TO_LSB>
+void prefix_code_table<MSB_TO_LSB>::fill(size_type offset, unsigned bits,
+                                         unsigned consumed,
+                                         const std::vector<uint32_t>& codes,
+                                         const symbol_type* sorted,
+                                         size_type n) {
+  // codes in code order share their first consumed bits and are longer
+  const unsigned end = consumed + bits;
+  size_type i = 0;
+  while (i < n) {
+    const symbol_type symbol = sorted[i];
+    const unsigned length = lengths_[symbol];
+    const uint64_t code = codes[symbol];
+
+    if (length <= end) {
+      // one entry for every value of the bits past the code
+      const unsigned width = length - consumed;
+      const uint64_t value = code & ((uint64_t(1) << width) - 1);
+      const uint32_t entry =
+          (symbol << VALUE_SHIFT) | VALID | static_cast<uint32_t>(length);
+      for (uint64_t rest = 0; rest < (uint64_t(1) << (end - length));
+           rest++) {
+        entries_[offset + place(value, width, rest, end - length)] = entry;
+      }
+      i++;
+      continue;
+    }
+
+    // longer codes with the same next bits share a sub table, the last of
+    // them is the longest
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    const uint64_t prefix = (code >> (length - end)) & mask;
+    size_type j = i + 1;
+    while ((j < n) &&
+           (((codes[sorted[j]] >> (lengths_[sorted[j]] - end)) & mask) ==
+            prefix)) {
+      j++;
+    }
+
+    const unsigned sub_bits =
+        std::min(lengths_[sorted[j - 1]] - end, root_bits_);
+    const size_type sub_offset = entries_.size();
+    if (sub_offset >= (size_type(1) << (32 - VALUE_SHIFT))) {
+      throw std::invalid_argument("prefix code table is too large.");
+    }
+
+    entries_.resize(sub_offset + (size_type(1) << sub_bits), 0);
+    entries_[offset + place(prefix, bits, 0, 0)] =
+        static_cast<uint32_t>(sub_offset << VALUE_SHIFT) | LINK | sub_bits;
+    fill(sub_offset, sub_bits, end, codes, sorted + i, j - i);
+    i = j;
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::prefix_decoder(
+    const table_type& table, reader_type& reader) noexcept
+    : table_(table), reader_(reader) {}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+typename prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::symbol_type
+prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::decode() {
+  symbol_type symbol;
+  decode_n(&symbol, 1);
+  return symbol;
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+void prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::decode_n(
+    symbol_type* symbols, size_type n) {
+  const uint32_t* entries = table_.entries_.data();
+  const unsigned root_bits = table_.root_bits_;
+  const unsigned window = table_.window_bits_;
+  size_type i = 0;
+  while (i < n) {
+    reader_.refill();
+
+    // the cache may hold padding past the last bit
+    size_type available = std::min(reader_.cache_bits_, reader_.bits_left());
+    if (available < window) {
+      symbols[i++] = decode_straddling();
+      continue;
+    }
+
+    // in locals, the symbol stores could alias the table and the reader
+    uint64_t cache = reader_.cache_;
+    size_type used = 0;
+    uint32_t entry;
+    do {
+      entry = table_type::lookup(entries, root_bits, cache);
+      if ((entry & table_type::VALID) == 0) {
+        break;
+      }
+
+      const unsigned length = entry & table_type::LENGTH_MASK;
+      symbols[i++] = entry >> table_type::VALUE_SHIFT;
+      cache = MSB_TO_LSB ? cache << length : cache >> length;
+      used += length;
+      available -= length;
+    } while ((i < n) && (available >= window));
+
+    reader_.cache_ = cache;
+    reader_.cache_bits_ -= used;
+    if ((entry & table_type::VALID) == 0) {
+      throw std::invalid_argument("prefix code is not in the table.");
+    }
+  }
+}
+
+template <class BIT_CONTAINER_TYPE, bool MSB_TO_LSB>
+typename prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::symbol_type
+prefix_decoder<BIT_CONTAINER_TYPE, MSB_TO_LSB>::decode_straddling() {
+  constexpr size_type T_BIT_SIZE = reader_type::T_BIT_SIZE;
+
+  if (reader_.bits_left() == 0) {
+    throw std::out_of_range("prefix code is out of range.");
+  }
+
+  // the cache and the next element, the bits past the end are zero
+  uint64_t window = reader_.cache_;
+  const size_type cached = reader_.cache_bits_;
+  if ((cached < 64) && (reader_.next_element_ < reader_.element_count_)) {
+    const uint64_t word = reader_.element(reader_.next_element_);
+    window |= MSB_TO_LSB ? (word << (64 - T_BIT_SIZE)) >> cached
+                         : word << cached;
+  }
+
+  const uint32_t entry = table_type::lookup(table_.entries_.data(),
+                                           table_.root_bits_, window);
+  if ((entry & table_type::VALID) == 0) {
+    throw std::invalid_argument("prefix code is not in the table.");
+  }
+
+  const unsigned length = entry & table_type::LENGTH_MASK;
+  if (length > reader_.bits_left()) {
+    throw std::out_of_range("prefix code is out of range.");
+  }
+
+  reader_.skip_bits(length);
+  return entry >> table_type::VALUE_SHIFT;
+}
+}  // namespace jcy
+
+#endif  // PREFIX_CODE_HPP_
@@ -1,6 +1,165 @@
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
 
+#include "atomic_bit.hpp"
 #include "bit.hpp"
+#include "bit_convert.hpp"
+#include "bit_interleave.hpp"
+#include "bit_serialize.hpp"
+#include "bit_stream_builder.hpp"
+#include "compressed_bit.hpp"
+#include "emulation_prevention.hpp"
+#include "fixed_bit.hpp"
+#include "mapped_bit.hpp"
+#include "parallel_bit.hpp"
+#include "prefix_code.hpp"
+
+// the parallel_* ops on an explicit four thread pool match the serial ops,
+// at sizes and positions around the PARALLEL_MIN_BYTES part boundaries
+bool check_parallel() {
+  typedef jcy::bit<uint64_t> bit_type;
+  const auto same = [](const bit_type& a, const bit_type& b) {
+    return a.sub_range(0, a.size()) == b.sub_range(0, b.size());
+  };
+
+  jcy::thread_pool pool(4);
+  std::mt19937_64 rng(2019);
+  const size_t part = 8 * jcy::detail::PARALLEL_MIN_BYTES;
+  bool ok = true;
+  for (const size_t n : {part - 1, part, part + 1, 2 * part - 64,
+                         2 * part + 63, 5 * part + 7}) {
+    bit_type x;
+    bit_type y;
+    for (size_t i = 0; i < n; i += 64) {
+      x.push_bits(rng(), std::min<size_t>(64, n - i));
+      y.push_bits(rng(), std::min<size_t>(64, n - i));
+    }
+
+    bit_type serial = x;
+    bit_type parallel = x;
+    ok = ok && (jcy::parallel_count(x, pool) == x.count());
+    jcy::parallel_and(parallel, y, pool);
+    ok = ok && same(parallel, serial &= y);
+    parallel = serial = x;
+    jcy::parallel_or(parallel, y, pool);
+    ok = ok && same(parallel, serial |= y);
+    parallel = serial = x;
+    jcy::parallel_xor(parallel, y, pool);
+    ok = ok && same(parallel, serial ^= y);
+    parallel = serial = x;
+    jcy::parallel_andnot(parallel, y, pool);
+    ok = ok && same(parallel, serial.andnot(y));
+    ok = ok && jcy::parallel_equal(x, bit_type(x), pool) &&
+         !jcy::parallel_equal(x, y, pool);
+
+    const bit_type indexed = x;
+    jcy::parallel_build_rank_index(indexed, pool);
+    for (size_t k = 0; k < n; k += part / 3) {
+      ok = ok && (indexed.rank1(k) == x.rank1(k));
+    }
+    ok = ok && (indexed.rank1(n) == x.rank1(n));
+
+    // a single one, and a single zero, on either side of each boundary
+    bit_type ones;
+    ones.resize(n);
+    bit_type zeros = ~ones;
+    ok = ok && (jcy::parallel_find_first(ones, pool) == bit_type::npos) &&
+         (jcy::parallel_find_first_zero(zeros, pool) == bit_type::npos);
+    for (size_t boundary = part; boundary < n + part; boundary += part) {
+      for (const size_t pos : {boundary - 1, boundary}) {
+        const size_t at = std::min(pos, n - 1);
+        *(ones.begin() + at) = 1;
+        *(zeros.begin() + at) = 0;
+        ok = ok && (jcy::parallel_find_first(ones, pool) == at) &&
+             (jcy::parallel_find_first_zero(zeros, pool) == at);
+        *(ones.begin() + at) = 0;
+        *(zeros.begin() + at) = 1;
+      }
+    }
+  }
+  return ok;
+}
+
+// compressed_bit ops match the bit ops on array, bitmap and run chunks,
+// including chunks only one side has, and to_bit() gives the bits back
+bool check_compressed() {
+  typedef jcy::bit<uint64_t> bit_type;
+  typedef jcy::compressed_bit<uint64_t> compressed_type;
+  const auto same = [](const bit_type& a, const bit_type& b) {
+    return a.sub_range(0, a.size()) == b.sub_range(0, b.size());
+  };
+
+  // per chunk none, sparse (array), dense (bitmap) or runs, so both sides
+  // differ in every chunk and x has no chunk 3
+  const int x_kinds[] = {1, 2, 3, 0, 1};
+  const int y_kinds[] = {2, 3, 1, 3, 2};
+  const size_t chunk = compressed_type::CHUNK_BIT_SIZE;
+  std::mt19937_64 rng(2019);
+  const auto pick = [&rng](int kind, size_t i) {
+    const uint64_t r = rng();
+    return kind == 1 ? r % 97 == 0
+                     : kind == 2 ? r % 2 == 0 : kind == 3 && (i / 700) % 3 == 0;
+  };
+
+  bit_type x;
+  bit_type y;
+  for (size_t i = 0; i < 4 * chunk + 1000; i++) {
+    x.push(pick(x_kinds[i / chunk], i));
+    y.push(pick(y_kinds[i / chunk], i));
+  }
+
+  const compressed_type cx(x);
+  const compressed_type cy(y);
+  bool ok = same(cx.to_bit(), x) && same(cy.to_bit(), y) &&
+            (cx.count() == x.count()) && (cy.count() == y.count());
+  for (size_t k = 0; k <= x.size(); k += chunk / 3) {
+    ok = ok && (cx.rank1(k) == x.rank1(k));
+  }
+
+  compressed_type c = cx;
+  bit_type b = x;
+  ok = ok && same((c &= cy).to_bit(), b &= y) && (c.count() == b.count());
+  c = cx;
+  b = x;
+  ok = ok && same((c |= cy).to_bit(), b |= y) && (c.count() == b.count());
+  c = cx;
+  b = x;
+  ok = ok && same((c ^= cy).to_bit(), b ^= y) && (c.count() == b.count());
+  c = cy;
+  b = y;
+  ok = ok && same((c ^= cx).to_bit(), b ^= x) && (c.count() == b.count());
+  return ok;
+}
+
+// concurrent claims on an explicit four thread pool hand out distinct
+// positions, one per caller, until every bit is set
+bool check_claims() {
+  const size_t n = 5000;
+  jcy::atomic_bit<uint64_t> claims(n);
+  std::vector<size_t> claimed(n);
+  jcy::thread_pool pool(4);
+  pool.parallel_for(n, [&claims, &claimed](size_t i) {
+    claimed[i] =
+        claims.find_and_claim_first_zero(i % 7, std::memory_order_acq_rel);
+  });
+
+  std::sort(claimed.begin(), claimed.end());
+  bool ok = (claims.count() == n) && (claimed.back() < n) &&
+            (std::adjacent_find(claimed.begin(), claimed.end()) ==
+             claimed.end()) &&
+            (claims.find_and_claim_first_zero() == claims.npos);
+
+  // moves leave the source empty
+  jcy::atomic_bit<uint64_t> moved(std::move(claims));
+  ok = ok && (moved.count() == n) && (claims.size() == 0) &&
+       (claims.count() == 0) && (claims.shard_count() == 0);
+  claims = std::move(moved);
+  return ok && (claims.count() == n) && (moved.count() == 0);
+}
 
 int main() {
   jcy::bit<uint64_t> bit2;
@@ -44,26 +203,28 @@ int main() {
   bit2.push_bytes(bytes.data(), bytes.size());
   std::cout << std::dec << "size " << bit2.size() << std::endl;
 
-  std::chrono::high_resolution_clock::time_point start, end;
+  jcy::bit<uint64_t> wide;
+  wide.push(1);
+  wide.push_bytes(bytes.begin(), bytes.end());
+  std::cout << std::hex << "wide " << wide.data()[0] << std::dec << std::endl;
 
-  bit2.reserve(1000000);
-  start = std::chrono::high_resolution_clock::now();
-  for (size_t i = 0; i < 20000000; i++) {
+  // timings live in bench.cpp
+  bit2.reserve(4096);
+  for (size_t i = 0; i < 4000; i++) {
     bit2.push(0);
   }
-  end = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> dur = end - start;
-  std::cout << dur.count() << std::endl;
-  std::cout << "write " << 20000000 / dur.count() << " bits/s" << std::endl;
-
-  start = std::chrono::high_resolution_clock::now();
-  for (size_t i = 0; i < 20000000; i++) {
-    (void)bit2[i];
+
+  jcy::bit<uint64_t> bit3;
+  for (size_t i = 0; i < 1000; i++) {
+    bit3.push_bits(i, 20);
   }
-  end = std::chrono::high_resolution_clock::now();
-  dur = end - start;
-  std::cout << dur.count() << std::endl;
-  std::cout << "read " << 20000000 / dur.count() << " bits/s" << std::endl;
+
+  jcy::bit_reader<uint64_t> reader(bit3);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < 1000; i++) {
+    sum += reader.read_bits(20);
+  }
+  std::cout << "fields " << sum << std::endl;
 
   jcy::bit<uint64_t> value;
   value = {0, 1, 1};
@@ -92,5 +253,173 @@ int main() {
   std::cout << value4.buffer_element_count() * value4.buffer_element_size()
             << std::endl;
 
+  std::cout << "rank " << bit2.rank1(bit2.size()) << " select "
+            << bit2.select1(3) << " " << bit2.select0(0) << std::endl;
+
+  std::cout << "find " << bit2.find_first() << " " << bit2.find_next(0) << " "
+            << bit2.find_last() << " " << bit2.find_first_zero() << std::endl;
+
+  jcy::bit<uint64_t> mask(bit2.size(), 1);
+  mask.replace(0, 0);
+  std::cout << "count " << (bit2 & mask).count() << " "
+            << (bit2 | mask).count() << " " << (~mask).count() << std::endl;
+
+  jcy::bit<unsigned char> header;
+  header.push_ue(5);
+  header.push_se(-3);
+  jcy::bit_reader<unsigned char> header_reader(header);
+  std::cout << header.size() << " " << header_reader.read_ue() << " "
+            << header_reader.read_se() << std::endl;
+
+  // the batch decode crosses windows, elements and one long code
+  jcy::bit<unsigned char> golomb;
+  golomb.push_ue(uint64_t(1) << 40);
+  for (int64_t i = -100; i < 100; i++) golomb.push_se(i);
+  jcy::bit_reader<unsigned char> golomb_reader(golomb);
+  uint64_t long_code = 0;
+  int64_t codes[200];
+  golomb_reader.read_ue(&long_code, 1);
+  golomb_reader.read_se(codes, 200);
+  for (int64_t i = 0; i < 200; i++) {
+    if (codes[i] != i - 100) {
+      std::cout << "batch exp-golomb mismatch at " << i << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "batch " << long_code << " " << golomb_reader.bits_left()
+            << std::endl;
+
+  jcy::bit<uint64_t> slice(bit2.begin() + 1, bit2.end());
+  std::cout << "iterator " << slice.size() << " "
+            << count(slice.cbegin(), slice.cend(), 1) << " "
+            << (find(slice.cbegin(), slice.cend(), 0) - slice.cbegin())
+            << std::endl;
+
+  jcy::bit<uint64_t>::view_type field = bit2.sub_range(1, 9);
+  jcy::bit_reader<uint64_t> field_reader(field);
+  std::cout << "view " << field.size() << " " << field.count() << " "
+            << field_reader.read_bits(8) << std::endl;
+
+  jcy::bit<unsigned char> small;
+  small.push_bits(0xABC, 12);
+  jcy::bit<unsigned char> moved(std::move(small));
+  std::cout << "small " << moved.size() << " " << small.size() << std::endl;
+
+  constexpr jcy::fixed_bit<12> fixed{1, 0, 1, 1};
+  static_assert(fixed.count() == 3, "fixed_bit is not constexpr");
+  jcy::bit<unsigned char> unfixed = fixed.to_bit();
+  std::cout << "fixed " << fixed.bits(0, 12) << " " << unfixed.size()
+            << std::endl;
+
+  typedef jcy::mapped_bit<uint64_t> mapped_type;
+  {
+    mapped_type mapped("mapped.bit", mapped_type::open_mode::read_write);
+    mapped.append(bit2);
+    mapped.push_bits(0xABC, 12);
+  }
+  mapped_type mapped("mapped.bit", mapped_type::open_mode::read_only);
+  std::cout << "mapped " << mapped.size() << " " << mapped.view().count()
+            << " " << (std::as_const(mapped).data()[0] == bit2.data()[0])
+            << std::endl;
+  mapped.close();
+  std::remove("mapped.bit");
+
+  jcy::compressed_bit<uint64_t> compressed(bit2);
+  std::cout << "compressed " << compressed.count() << " "
+            << compressed.rank1(bit2.size() / 2) << " "
+            << compressed.buffer_byte_size() << std::endl;
+  if (!check_compressed()) {
+    std::cout << "compressed check failed" << std::endl;
+    return 1;
+  }
+
+  jcy::bit<uint64_t> parallel_mask = mask;
+  jcy::parallel_and(parallel_mask, bit2);
+  std::cout << "parallel " << jcy::parallel_count(bit2) << " "
+            << jcy::parallel_count(parallel_mask) << " "
+            << jcy::parallel_find_first(bit2) << std::endl;
+  if (!check_parallel()) {
+    std::cout << "parallel check failed" << std::endl;
+    return 1;
+  }
+
+  jcy::bit_stream_builder<unsigned char> builder(3);
+  jcy::thread_pool::global().parallel_for(3, [&builder](size_t i) {
+    builder.writer(i).push_bits(i + 1, 3);
+  });
+  jcy::bit<unsigned char> stream = builder.finalize();
+  std::cout << "builder " << stream.size() << " "
+            << static_cast<unsigned>(stream.data()[0]) << std::endl;
+
+  std::vector<uint64_t> serialized(jcy::serialized_size(bit2) / 8);
+  jcy::serialize(bit2, serialized.data(), 8 * serialized.size());
+  jcy::bit<uint64_t>::view_type opened =
+      jcy::serialized_view<uint64_t>(serialized.data(), 8 * serialized.size());
+  std::cout << "serialized " << 8 * serialized.size() << " "
+            << (opened == bit2.sub_range(0, bit2.size())) << " "
+            << jcy::deserialize<uint64_t>(serialized.data(),
+                                          8 * serialized.size())
+                   .count()
+            << std::endl;
+
+  const unsigned char payload[] = {0x00, 0x00, 0x01, 0x65, 0x00,
+                                   0x00, 0x02, 0x00, 0x00};
+  jcy::bit<unsigned char> nal;
+  nal.push_bytes(payload, sizeof(payload));
+  jcy::bit<unsigned char> escaped = jcy::insert_emulation_prevention(nal);
+  jcy::emulation_prevention_map escapes;
+  jcy::bit<unsigned char> unescaped =
+      jcy::remove_emulation_prevention(escaped, &escapes);
+  std::cout << "escape " << jcy::find_start_code(nal) << " " << escaped.size()
+            << " " << (unescaped.sub_range(0, 72) == nal.sub_range(0, 72))
+            << " " << escapes.escaped_bit_position(64) << std::endl;
+
+  jcy::bit<unsigned char> patched;
+  patched.push_bits(0xA5, 8);
+  patched.insert(4, 0x3, 2);
+  patched.erase(0, 1);
+  patched <<= 1;
+  std::cout << "patched " << patched.size() << " "
+            << static_cast<unsigned>(patched.data()[0]) << std::endl;
+
+  jcy::atomic_bit<uint64_t> slots(1000);
+  jcy::thread_pool::global().parallel_for(4, [&slots](size_t i) {
+    slots.find_and_claim_first_zero(i, std::memory_order_acq_rel);
+  });
+  std::cout << "atomic " << slots.count() << " " << slots.test_and_set(0)
+            << " " << slots.shard_count() << std::endl;
+  if (!check_claims()) {
+    std::cout << "atomic check failed" << std::endl;
+    return 1;
+  }
+
+  const auto converted = jcy::from_string<unsigned char>("1011001110001111");
+  std::cout << "convert " << jcy::to_string(converted) << " "
+            << jcy::to_indices(converted).size() << std::endl;
+
+  const jcy::bit<uint32_t, false> reordered(converted);
+  std::cout << "reordered " << reordered.size() << " " << std::hex
+            << reordered.data()[0] << std::dec << std::endl;
+
+  const auto morton = jcy::interleave(jcy::from_string<unsigned char>("0011"),
+                                      jcy::from_string<unsigned char>("0101"));
+  const uint8_t samples[2] = {0x80, 0x01};
+  jcy::bit<unsigned char> planes;
+  jcy::transpose_planes(samples, 2, planes);
+  std::cout << "morton " << jcy::to_string(morton) << " "
+            << jcy::to_string(jcy::deinterleave(morton).second) << " planes "
+            << jcy::to_string(planes) << std::endl;
+
+  const jcy::prefix_code_table<> huffman(std::vector<uint8_t>{1, 2, 3, 3});
+  const uint32_t message[6] = {0, 1, 3, 2, 0, 0};
+  uint32_t decoded[6] = {};
+  jcy::bit<unsigned char> coded;
+  huffman.encode_n(message, 6, coded);
+  jcy::bit_reader<unsigned char> coded_reader(coded);
+  jcy::prefix_decoder<unsigned char> decoder(huffman, coded_reader);
+  decoder.decode_n(decoded, 6);
+  std::cout << "huffman " << jcy::to_string(coded) << " " << decoded[2]
+            << std::endl;
+
   return 0;
 }
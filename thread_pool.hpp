@@ -0,0 +1,218 @@
+/**
+ * @file thread_pool.hpp
+ * @author Caoyang Jiang
+ * @brief
+ * @version 0.1
+ * @date 2019-12-03
+ *
+ * @copyright Copyright (c) 2019
+ *
+ */
+
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jcy {
+/**
+ * @brief A work stealing thread pool.
+ *
+ * Every worker owns a deque. Tasks are dealt to the deques round robin, a
+ * worker takes from the back of its own deque and steals from the front
+ * of the others when it runs dry. parallel_for() blocks until its tasks
+ * are done, the calling thread steals tasks meanwhile, so it can be
+ * called from inside a task.
+ */
+class thread_pool {
+ public:
+  typedef std::function<void()> task_type;
+
+ public:
+  // constructor, zero threads runs every task on the calling thread
+  explicit thread_pool(
+      size_t thread_count = std::thread::hardware_concurrency());
+  thread_pool(const thread_pool&) = delete;
+
+  // destructor, waits for the queued tasks
+  ~thread_pool();
+
+  // assignment operator
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  size_t size() const noexcept;
+
+  // run task on some worker
+  void submit(task_type task);
+
+  /**
+   * @brief Call f(i) for i in [0, n) and return when all calls are done.
+   * The first exception thrown by f is rethrown here.
+   */
+  template <class FUNCTION>
+  void parallel_for(size_t n, FUNCTION f);
+
+  // pool shared by the parallel_* functions
+  static thread_pool& global();
+
+ private:
+  struct task_queue {
+    std::mutex mutex;
+    std::deque<task_type> tasks;
+  };
+
+  static constexpr size_t NO_WORKER = static_cast<size_t>(-1);
+
+  inline bool pop(size_t self, task_type& task);
+  inline void work(size_t self);
+
+ private:
+  std::vector<std::unique_ptr<task_queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_{0};
+  std::atomic<size_t> queued_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+inline thread_pool::thread_pool(size_t thread_count) {
+  for (size_t i = 0; i < thread_count; i++) {
+    queues_.push_back(std::unique_ptr<task_queue>(new task_queue()));
+  }
+
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this, i] { work(i); });
+  }
+}
+
+inline thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+
+  for (std::thread& t : threads_) t.join();
+}
+
+inline size_t thread_pool::size() const noexcept { return threads_.size(); }
+
+inline void thread_pool::submit(task_type task) {
+  if (queues_.empty()) {
+    task();
+    return;
+  }
+
+  // counted first so it never drops below the tasks in the deques, and
+  // under the sleep mutex so no worker misses the wake up
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    queued_++;
+  }
+
+  task_queue& q = *queues_[next_queue_++ % queues_.size()];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+template <class FUNCTION>
+void thread_pool::parallel_for(size_t n, FUNCTION f) {
+  if ((n == 1) || queues_.empty()) {
+    for (size_t i = 0; i < n; i++) f(i);
+    return;
+  }
+
+  std::atomic<size_t> remaining(n);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  for (size_t i = 0; i < n; i++) {
+    submit([&, i] {
+      try {
+        f(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+      }
+      remaining--;
+    });
+  }
+
+  // help instead of blocking, the tasks may be queued behind this one
+  task_type task;
+  while (remaining.load() != 0) {
+    if (pop(NO_WORKER, task)) {
+      task();
+      task = nullptr;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+inline thread_pool& thread_pool::global() {
+  static thread_pool pool;
+  return pool;
+}
+
+inline bool thread_pool::pop(size_t self, task_type& task) {
+  const size_t count = queues_.size();
+  for (size_t k = 0; k < count; k++) {
+    const bool own = k == 0 && self != NO_WORKER;
+    task_queue& q = *queues_[((self == NO_WORKER ? 0 : self) + k) % count];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+      continue;
+    }
+
+    // newest from the own deque, oldest from a victim's
+    if (own) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+    queued_--;
+    return true;
+  }
+  return false;
+}
+
+inline void thread_pool::work(size_t self) {
+  task_type task;
+  while (true) {
+    if (pop(self, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] { return stop_ || queued_.load() != 0; });
+    if (stop_ && (queued_.load() == 0)) {
+      return;
+    }
+  }
+}
+}  // namespace jcy
+
+#endif  // THREAD_POOL_HPP_